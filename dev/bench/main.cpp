@@ -0,0 +1,462 @@
+/* Microbenchmarks of the engine's hot paths.
+ *
+ * usage: bench [--json <file>] [--filter <substring>] [--samples <n>]
+ *
+ * Run from the project root (assets are loaded by relative path), "make bench"
+ * does that. Every benchmark is warmed up first, then the number of
+ * iterations per sample is picked so a sample takes about sample_time, and
+ * samples are taken repeatedly. Results are in ns per iteration: min,
+ * median, mean, standard deviation and p90 over the samples. Min and median
+ * are the ones to compare, the mean is skewed by outliers.
+ *
+ * With --json the results are also written in a form dev/tools/benchcmp
+ * reads. */
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <ktx.h>
+
+#include "Collision_grid.hpp"
+#include "Snapshot_ring.hpp"
+#include "delta.hpp"
+#include "log_format.hpp"
+#include "logs.hpp"
+#include "scenario.hpp"
+#include "sim.hpp"
+#include "text.hpp"
+#include "utils.hpp"
+#include "version.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr std::chrono::milliseconds warmup_time {50};
+constexpr std::chrono::microseconds sample_time {2000};
+
+struct Result {
+    std::string name;
+    std::uint64_t iterations; // per sample
+    std::vector<double> ns_per_op; // one per sample, sorted
+};
+
+// keeps the compiler from dropping work whose result is unused
+template<typename T>
+void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+/* a benchmark whose work can't be done, it would time nothing and pass for
+   fast, so the whole run fails */
+[[noreturn]] void fail(const char* what)
+{
+    std::cerr << what << std::endl;
+    std::exit(1);
+}
+
+double run_batch(const std::function<void()>& fn, std::uint64_t iterations)
+{
+    const auto start {Clock::now()};
+    for (std::uint64_t i {0}; i < iterations; ++i) { fn(); }
+    const std::chrono::duration<double, std::nano> took {Clock::now() - start};
+    return took.count();
+}
+
+Result measure(
+    const std::string& name,
+    const std::function<void()>& fn,
+    std::size_t samples)
+{
+    // warm-up doubles as calibration of the iterations per sample
+    std::uint64_t iterations {1};
+    const auto warmup_end {Clock::now() + warmup_time};
+    double batch_ns {0.0};
+    do {
+        batch_ns = run_batch(fn, iterations);
+        if (batch_ns < sample_time.count() * 1000.0 / 2) { iterations *= 2; }
+    } while (Clock::now() < warmup_end);
+    iterations = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(
+        iterations * (sample_time.count() * 1000.0) / batch_ns));
+
+    Result res {name, iterations, {}};
+    res.ns_per_op.reserve(samples);
+    for (std::size_t i {0}; i < samples; ++i) {
+        res.ns_per_op.push_back(run_batch(fn, iterations) / iterations);
+    }
+    std::sort(res.ns_per_op.begin(), res.ns_per_op.end());
+
+    return res;
+}
+
+double mean(const std::vector<double>& v)
+{
+    double sum {0.0};
+    for (double x : v) { sum += x; }
+    return sum / v.size();
+}
+
+double stddev(const std::vector<double>& v)
+{
+    const double m {mean(v)};
+    double sum {0.0};
+    for (double x : v) { sum += (x - m) * (x - m); }
+    return v.size() > 1 ? std::sqrt(sum / (v.size() - 1)) : 0.0;
+}
+
+// of sorted samples
+double percentile(const std::vector<double>& v, double p)
+{
+    const auto i {static_cast<std::size_t>(std::ceil(p * v.size()))};
+    return v[std::min(v.size() - 1, i > 0 ? i - 1 : 0)];
+}
+
+void print(const Result& res)
+{
+    std::cout << std::left << std::setw(22) << res.name << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(12) << res.ns_per_op.front()
+              << std::setw(12) << percentile(res.ns_per_op, 0.5)
+              << std::setw(12) << mean(res.ns_per_op)
+              << std::setw(10) << stddev(res.ns_per_op)
+              << std::setw(12) << percentile(res.ns_per_op, 0.9)
+              << std::setw(12) << res.iterations << std::endl;
+}
+
+bool write_json(const char* path, const std::vector<Result>& results)
+{
+    std::ofstream out {path};
+    out << "{\n  \"version\": \"" << version_str() << "\",\n"
+        << "  \"unit\": \"ns\",\n  \"benchmarks\": [";
+    for (std::size_t i {0}; i < results.size(); ++i) {
+        const Result& res {results[i]};
+        out << (i == 0 ? "\n" : ",\n") << std::fixed << std::setprecision(2)
+            << "    {\"name\": \"" << res.name << "\""
+            << ", \"iterations\": " << res.iterations
+            << ", \"samples\": " << res.ns_per_op.size()
+            << ", \"min\": " << res.ns_per_op.front()
+            << ", \"median\": " << percentile(res.ns_per_op, 0.5)
+            << ", \"mean\": " << mean(res.ns_per_op)
+            << ", \"stddev\": " << stddev(res.ns_per_op)
+            << ", \"p90\": " << percentile(res.ns_per_op, 0.9) << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    return static_cast<bool>(out);
+}
+
+// the arena as main() sets it up, 40 units from the camera with 60deg FOV
+constexpr Boxf arena {-41.05f, -23.09f, 82.1f, 46.18f};
+
+struct Benchmark {
+    const char* name;
+    std::function<void()> fn;
+};
+
+std::vector<Benchmark> benchmarks()
+{
+    std::vector<Benchmark> list;
+
+    // slow enough bullets never leave the arena during a run
+    auto bullets {std::make_shared<sim::Bullets>()};
+    for (int i {0}; i < 1024; ++i) {
+        bullets->push_back(Bullet{
+            glm::vec3{(i % 64) - 32.0f, (i / 64) - 8.0f, 0.0f},
+            glm::vec3{1e-7f, -1e-7f, 0.0f}});
+    }
+    list.push_back({"bullet_update_1024", [bullets] {
+        sim::update_bullets(*bullets, arena);
+        do_not_optimize(bullets->data());
+    }});
+
+    // fast ships close to the edges, most of them wrap on every update
+    static Model3 model;
+    auto ships {std::make_shared<std::vector<Ship>>()};
+    for (int i {0}; i < 256; ++i) {
+        ships->push_back(Ship{
+            &model,
+            glm::vec3{arena.x + (i % 2) * arena.w, arena.y + (i % 3), 0.0f},
+            glm::vec3{0.0f, 0.0f, i * 1.4f},
+            glm::vec3{1.0f}});
+        ships->back().vel = glm::vec3{(i % 2) ? 2.0f : -2.0f, 0.5f, 0.0f};
+    }
+    list.push_back({"arena_wrap_256", [ships] {
+        sim::update_ships(ships->data(), ships->size(), arena, 1.0f / 60);
+        do_not_optimize(ships->data());
+    }});
+
+    /* a whole simulation step as the frame loop runs it: ships firing
+       whenever they can, bullets flying out and getting dropped, steady
+       state after the first few hundred steps */
+    struct Sim_state {
+        std::vector<Ship> ships;
+        sim::Bullets bullets;
+    };
+    auto state {std::make_shared<Sim_state>()};
+    for (int i {0}; i < 8; ++i) {
+        state->ships.push_back(Ship{
+            &model,
+            glm::vec3{-30.0f + i * 8.0f, (i % 2) * 10.0f - 5.0f, 0.0f},
+            glm::vec3{0.0f, 0.0f, i * 45.0f},
+            glm::vec3{1.0f}});
+        state->ships.back().vel = glm::vec3{0.05f, -0.03f, 0.0f};
+    }
+    list.push_back({"sim_step_8_ships", [state] {
+        for (Ship& ship : state->ships) {
+            sim::fire(ship, state->bullets, 0.05f);
+            ship.rot.z += 3.0f;
+            if (ship.rot.z >= 360.0f) { ship.rot.z -= 360.0f; }
+        }
+        sim::update_bullets(state->bullets, arena);
+        sim::update_ships(
+            state->ships.data(), state->ships.size(), arena, 1.0f / 60);
+        do_not_optimize(state->bullets.data());
+    }});
+
+    // rocks spread over the arena, bullets checked against the 3x3 cells
+    static Model3 rock_model;
+    auto grid_world {std::make_shared<sim::World>()};
+    grid_world->arena = arena;
+    grid_world->rng.reseed(3);
+    for (int i {0}; i < 256; ++i) {
+        grid_world->rocks.push_back(Rock{
+            &rock_model, glm::vec3{0.0f}, glm::vec3{0.0f}, 1.0f, 0.0f});
+        sim::respawn_rock(*grid_world, grid_world->rocks.back());
+        grid_world->rocks.back().pos = glm::vec3{
+            grid_world->rng.uniform(arena.x, arena.x + arena.w),
+            grid_world->rng.uniform(arena.y, arena.y + arena.h),
+            0.0f};
+    }
+    for (int i {0}; i < 1024; ++i) {
+        grid_world->bullets.push_back(Bullet{
+            glm::vec3{
+                grid_world->rng.uniform(arena.x, arena.x + arena.w),
+                grid_world->rng.uniform(arena.y, arena.y + arena.h),
+                0.0f},
+            glm::vec3{0.0f}});
+    }
+    auto grid {std::make_shared<Collision_grid>()};
+    grid->reset(arena, sim::max_rock_radius);
+    list.push_back({"broadphase_256_1024", [grid_world, grid] {
+        const sim::World& world {*grid_world};
+        grid->build(world.rocks.size(), [&world](std::size_t i) {
+            return world.rocks[i].pos;
+        });
+        std::uint32_t candidates {0};
+        for (const Bullet& bullet : world.bullets) {
+            grid->query(
+                bullet.pos.x, bullet.pos.y,
+                [&candidates](std::uint32_t) { ++candidates; });
+        }
+        do_not_optimize(candidates);
+    }});
+
+    // a scenario run until the bullet count levelled out
+    auto scn_world {std::make_shared<sim::World>()};
+    scn_world->arena = arena;
+    scenario::Config scn;
+    scn.ai_ships = 32;
+    scn.rocks = 128;
+    scn.fire_rate = 4.0f;
+    scenario::populate(scn, *scn_world, &model, &rock_model);
+    for (int i {0}; i < 2400; ++i) { sim::step(*scn_world, 1.0f / 60); }
+    list.push_back({"scenario_step_32_128", [scn_world] {
+        sim::step(*scn_world, 1.0f / 60);
+        do_not_optimize(scn_world->bullets.data());
+    }});
+
+    // the copy every step costs to be able to roll back
+    auto snapshots {std::make_shared<Snapshot_ring>(8)};
+    list.push_back({"snapshot_save", [scn_world, snapshots] {
+        snapshots->save(*scn_world);
+        do_not_optimize(snapshots->find(scn_world->steps));
+    }});
+
+    /* a rollback as netcode does it on late input: back 8 steps and
+       simulate them again */
+    auto rb_world {std::make_shared<sim::World>()};
+    sim::save(*scn_world, *rb_world);
+    auto rb_snapshots {std::make_shared<Snapshot_ring>(16)};
+    for (int i {0}; i < 8; ++i) {
+        rb_snapshots->save(*rb_world);
+        sim::step(*rb_world, 1.0f / 60);
+    }
+    rb_snapshots->save(*rb_world);
+    list.push_back({"rollback_8_steps", [rb_world, rb_snapshots] {
+        const std::uint64_t now {rb_world->steps};
+        rb_snapshots->restore(now - 8, *rb_world);
+        while (rb_world->steps < now) {
+            sim::step(*rb_world, 1.0f / 60);
+            rb_snapshots->save(*rb_world);
+        }
+        do_not_optimize(rb_world->bullets.data());
+    }});
+
+    /* a snapshot for a client that has the state ack_lag steps before, as
+       --delta-stats makes them */
+    auto dl_world {std::make_shared<sim::World>()};
+    sim::save(*scn_world, *dl_world);
+    auto dl_frames {std::make_shared<std::vector<delta::Frame>>(3)};
+    delta::capture(*dl_world, (*dl_frames)[0]);
+    for (std::size_t i {0}; i < delta::ack_lag; ++i) {
+        sim::step(*dl_world, 1.0f / 60);
+    }
+    auto dl_bytes {std::make_shared<std::vector<std::uint8_t>>()};
+    list.push_back({"delta_encode", [dl_world, dl_frames, dl_bytes] {
+        dl_bytes->clear();
+        delta::capture(*dl_world, (*dl_frames)[1]);
+        delta::encode((*dl_frames)[1], (*dl_frames)[0], *dl_bytes);
+        do_not_optimize(dl_bytes->data());
+    }});
+    auto dl_encoded {std::make_shared<std::vector<std::uint8_t>>()};
+    delta::capture(*dl_world, (*dl_frames)[1]);
+    delta::encode((*dl_frames)[1], (*dl_frames)[0], *dl_encoded);
+    list.push_back({"delta_decode", [dl_frames, dl_encoded] {
+        delta::decode(dl_encoded->data(), dl_encoded->size(),
+                      (*dl_frames)[0], (*dl_frames)[2]);
+        do_not_optimize((*dl_frames)[2].bullets.data());
+    }});
+
+    auto verts {std::make_shared<std::vector<float>>()};
+    verts->reserve(64 * 30);
+    list.push_back({"text_layout_64", [verts] {
+        verts->clear();
+        layout_text(
+            "draws 12 (1040 verts) progs 3 unis 40 uploads 5 (2048 B) tex 1",
+            -40.0f, 20.0f, 1.0f, *verts);
+        do_not_optimize(verts->data());
+    }});
+
+    list.push_back({"log_encode", [] {
+        logs::Record rec {};
+        logs::Encoder enc {rec};
+        logs::encode(enc, "shader program reloaded: ");
+        logs::encode(enc, std::string_view{"shaders/simple.vert"});
+        logs::encode(enc, 42);
+        logs::encode(enc, 3.25);
+        do_not_optimize(rec);
+    }});
+
+    auto rec {std::make_shared<logs::Record>()};
+    {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        rec->ts_sec = ts.tv_sec;
+        rec->ts_nsec = ts.tv_nsec;
+        rec->level = logs::Level::info;
+        logs::Encoder enc {*rec};
+        logs::encode(enc, "shader program reloaded: ");
+        logs::encode(enc, std::string_view{"shaders/simple.vert"});
+        logs::encode(enc, 42);
+        logs::encode(enc, 3.25);
+    }
+    auto out {std::make_shared<std::ostringstream>()};
+    list.push_back({"log_format", [rec, out] {
+        out->seekp(0);
+        logs::format_record(
+            *rec, nullptr,
+            [](std::uint64_t addr, void*) -> std::string_view {
+                return reinterpret_cast<const char*>(addr);
+            },
+            nullptr, *out);
+        do_not_optimize(*out);
+    }});
+
+    list.push_back({"timestamp_nano", [] {
+        do_not_optimize(*timestamp_nano());
+    }});
+
+    auto source {std::make_shared<std::string>()};
+    list.push_back({"shader_file_load", [source] {
+        if (!read_text_file("shaders/simple.vert", *source)) {
+            fail("can not read shaders/simple.vert");
+        }
+        do_not_optimize(source->data());
+    }});
+
+    // the atlases are zlib supercompressed, loading includes inflating
+    list.push_back({"ktx_load_sdf_atlas", [] {
+        ktxTexture2* tex;
+        if (ktxTexture2_CreateFromNamedFile(
+                "gfx/fonts/terminus_8x16_sdf.ktx2",
+                KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &tex) != KTX_SUCCESS)
+        {
+            fail("can not load gfx/fonts/terminus_8x16_sdf.ktx2");
+        }
+        if (ktxTexture2_NeedsTranscoding(tex)) {
+            ktxTexture2_TranscodeBasis(tex, KTX_TTF_BC4_R, 0);
+        }
+        do_not_optimize(tex->pData);
+        ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(tex));
+    }});
+
+    return list;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const char* json_path {nullptr};
+    std::string_view filter;
+    std::size_t samples {30};
+    for (int i {1}; i < argc; ++i) {
+        const std::string_view arg {argv[i]};
+        if (arg == "--json" && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--samples" && i + 1 < argc) {
+            samples = std::max(1, std::atoi(argv[++i]));
+        } else {
+            std::cerr << "usage: " << argv[0] << " [--json <file>]"
+                      << " [--filter <substring>] [--samples <n>]"
+                      << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << version_str() << ", " << samples << " samples, ns/op\n"
+              << std::left << std::setw(22) << "benchmark" << std::right
+              << std::setw(12) << "min" << std::setw(12) << "median"
+              << std::setw(12) << "mean" << std::setw(10) << "stddev"
+              << std::setw(12) << "p90" << std::setw(12) << "iters"
+              << std::endl;
+
+    std::vector<Result> results;
+    for (const auto& bench : benchmarks()) {
+        if (std::string_view{bench.name}.find(filter) ==
+            std::string_view::npos)
+        {
+            continue;
+        }
+        results.push_back(measure(bench.name, bench.fn, samples));
+        print(results.back());
+    }
+
+    if (json_path != nullptr && !write_json(json_path, results)) {
+        std::cerr << "can not write " << json_path << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
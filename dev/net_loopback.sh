@@ -0,0 +1,44 @@
+#!/bin/bash
+# Two headless peers of a networked game on this machine, talking over UDP
+# loopback with latency, jitter and loss added. Both hash every confirmed
+# step, the run fails unless the hashes are the same on both sides.
+#
+#   dev/net_loopback.sh [frames] [latency ms] [jitter ms] [loss %] [-- args]
+#
+# Arguments after "--" go to both peers, e.g. "-- --scenario <file>".
+# Rollback stats are in the logs, peer0.log and peer1.log in the work dir
+# (RNB_NET_DIR, a temporary one by default).
+
+settings=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do settings+=("$1"); shift; done
+[ "$1" = "--" ] && shift
+frames=${settings[0]:-600}
+latency=${settings[1]:-40}
+jitter=${settings[2]:-15}
+loss=${settings[3]:-5}
+
+dir=${RNB_NET_DIR:-$(mktemp -d)}
+mkdir -p "$dir"
+export LD_LIBRARY_PATH=./lib/
+
+impair="--net-latency $latency --net-jitter $jitter --net-loss $loss"
+for p in 0 1; do
+    ./exe --headless --frames "$frames" "$@" $impair \
+        --net-player $p --net-port $((47100 + p)) \
+        --net-peer 127.0.0.1:$((47101 - p)) \
+        --hash-log "$dir/peer$p.hashes" > "$dir/peer$p.log" 2>&1 &
+    pids[$p]=$!
+done
+
+rc=0
+for p in 0 1; do
+    wait ${pids[$p]} || { echo "peer $p failed, see $dir/peer$p.log"; rc=1; }
+done
+grep -h "rollback:" "$dir/peer0.log" "$dir/peer1.log"
+
+if ! cmp -s "$dir/peer0.hashes" "$dir/peer1.hashes"; then
+    echo "peers disagree, hashes in $dir"
+    exit 1
+fi
+[ $rc -eq 0 ] && echo "peers agree on $frames frames"
+exit $rc
@@ -0,0 +1,46 @@
+#!/bin/bash
+# A dedicated server and a few headless clients on this machine, talking over
+# UDP loopback. Fails unless every client gets its snapshots; tick times and
+# the bandwidth per client are in the logs.
+#
+#   dev/server_loopback.sh [clients] [frames] [-- args]
+#
+# Arguments after "--" go to the server, e.g. "-- --scenario <file>". The
+# logs, server.log and client<n>.log, are in the work dir (RNB_NET_DIR, a
+# temporary one by default).
+
+settings=()
+while [ $# -gt 0 ] && [ "$1" != "--" ]; do settings+=("$1"); shift; done
+[ "$1" = "--" ] && shift
+clients=${settings[0]:-4}
+frames=${settings[1]:-600}
+port=47200
+
+dir=${RNB_NET_DIR:-$(mktemp -d)}
+mkdir -p "$dir"
+export LD_LIBRARY_PATH=./lib/
+
+# runs on until the clients are done
+./server --port $port --slots "$clients" "$@" > "$dir/server.log" 2>&1 &
+server=$!
+sleep 0.2
+
+for c in $(seq 1 "$clients"); do
+    ./exe --headless --frames "$frames" --connect 127.0.0.1:$port \
+        > "$dir/client$c.log" 2>&1 &
+    pids[$c]=$!
+done
+
+rc=0
+for c in $(seq 1 "$clients"); do
+    wait ${pids[$c]} || {
+        echo "client $c failed, see $dir/client$c.log"
+        rc=1
+    }
+done
+kill -INT $server
+wait $server || { echo "server failed, see $dir/server.log"; rc=1; }
+grep -h "cpu ms\|server: player .* snapshots" "$dir/server.log"
+
+[ $rc -eq 0 ] && echo "$clients clients got $frames snapshots each"
+exit $rc
@@ -0,0 +1,130 @@
+/* Drives librnb_batch.so through its C API the way a trainer would: random
+ * input for every player each step, an observation of every world after it,
+ * and reports the simulation steps per second over all worlds.
+ *
+ * usage: batchrun [worlds] [steps] [threads] [ai ships] [rocks]
+ *
+ * Defaults are 1024 worlds, 600 steps, a thread per core, 4 AI ships and 32
+ * rocks. Before timing it checks a few steps come out the same on one thread
+ * as on all of them. Written in C to keep the API honest. */
+
+#define _POSIX_C_SOURCE 199309L /* clock_gettime() */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+
+static uint32_t arg_or(int argc, char** argv, int i, uint32_t fallback)
+{
+    return i < argc ? (uint32_t)strtoul(argv[i], NULL, 10) : fallback;
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* xorshift, different every step and player */
+static void random_inputs(uint8_t* inputs, size_t count, uint64_t* state)
+{
+    for (size_t i = 0; i < count; ++i) {
+        *state ^= *state << 13;
+        *state ^= *state >> 7;
+        *state ^= *state << 17;
+        inputs[i] = (uint8_t)(*state & 0xf);
+    }
+}
+
+/* the observations after 'steps' steps of the same random input */
+static int run(
+    const rnb_batch_config* config,
+    uint32_t steps,
+    uint8_t* inputs,
+    float* obs)
+{
+    rnb_batch* batch = rnb_batch_create(config);
+    if (batch == NULL) { return 0; }
+    uint64_t state = 88172645463325252ULL;
+    for (uint32_t s = 0; s < steps; ++s) {
+        random_inputs(inputs, (size_t)config->worlds * config->players,
+                      &state);
+        rnb_batch_step(batch, inputs, 1);
+    }
+    rnb_batch_observe(batch, obs);
+    rnb_batch_destroy(batch);
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    rnb_batch_config config;
+    memset(&config, 0, sizeof(config));
+    config.worlds = arg_or(argc, argv, 1, 1024);
+    const uint32_t steps = arg_or(argc, argv, 2, 600);
+    config.threads = arg_or(argc, argv, 3, 0);
+    config.ai_ships = arg_or(argc, argv, 4, 4);
+    config.rocks = arg_or(argc, argv, 5, 32);
+    config.players = 2;
+    config.fire_rate = 2.0f;
+
+    const size_t input_count = (size_t)config.worlds * config.players;
+    const size_t obs_size = (size_t)config.players * RNB_OBS_SHIP +
+        RNB_OBS_ROCKS * RNB_OBS_ROCK + 1;
+    const size_t obs_count = (size_t)config.worlds * obs_size;
+    uint8_t* inputs = malloc(input_count);
+    float* obs = malloc(obs_count * sizeof(float));
+    float* obs_one = malloc(obs_count * sizeof(float));
+    if (inputs == NULL || obs == NULL || obs_one == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    rnb_batch_config one = config;
+    one.threads = 1;
+    if (!run(&config, 60, inputs, obs) || !run(&one, 60, inputs, obs_one)) {
+        return 1;
+    }
+    if (memcmp(obs, obs_one, obs_count * sizeof(float)) != 0) {
+        fprintf(stderr, "worlds differ between one thread and more\n");
+        return 1;
+    }
+
+    rnb_batch* batch = rnb_batch_create(&config);
+    if (batch == NULL) { return 1; }
+    if (rnb_batch_observation_size(batch) != obs_size) {
+        fprintf(stderr, "observation size mismatch\n");
+        return 1;
+    }
+    uint64_t state = 2463534242ULL;
+    double step_s = 0.0;
+    const double start = now_s();
+    for (uint32_t s = 0; s < steps; ++s) {
+        random_inputs(inputs, input_count, &state);
+        const double before = now_s();
+        rnb_batch_step(batch, inputs, 1);
+        step_s += now_s() - before;
+        rnb_batch_observe(batch, obs);
+    }
+    const double total_s = now_s() - start;
+
+    double hits = 0.0;
+    for (uint32_t w = 0; w < config.worlds; ++w) {
+        hits += obs[w * obs_size + obs_size - 1];
+    }
+    const double world_steps = (double)config.worlds * steps;
+    printf("%u worlds x %u steps: %.0f steps/s stepping, %.0f steps/s with "
+           "observations, %.1f rocks hit per world\n",
+           config.worlds, steps, world_steps / step_s,
+           world_steps / total_s, hits / config.worlds);
+    rnb_batch_destroy(batch);
+    free(inputs);
+    free(obs);
+    free(obs_one);
+    return 0;
+}
@@ -0,0 +1,418 @@
+/* Compares a dev/bench --json run against a stored baseline and fails if
+ * anything got slower than the baseline's noise thresholds allow.
+ *
+ * usage: benchcmp <baseline.json> <results.json>...
+ *        benchcmp --update <baseline.json> <results.json>...
+ *
+ * Several results files are taken as one, e.g. dev/bench's and the frame
+ * times of a headless run (Frame_stats' --frame-json).
+ *
+ * The baseline has the same layout as the results, plus thresholds in
+ * percent for the metrics to compare, at the top for all benchmarks and
+ * optionally per benchmark to override them:
+ *
+ *   {"thresholds": {"min": 10, "median": 15},
+ *    "benchmarks": [{"name": "log_format", "min": 650.0, "median": 690.0,
+ *                    "thresholds": {"median": 25}}, ...]}
+ *
+ * Exits with 1 if a metric regressed past its threshold, 2 on bad input.
+ * Benchmarks only in one of the files are listed but don't fail the check.
+ * --update rewrites the baseline with the results' numbers, keeping the
+ * thresholds. */
+
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+// percent, for baselines without thresholds of their own
+const std::map<std::string, double> default_thresholds {
+    {"min", 10.0}, {"median", 15.0}};
+
+// just enough JSON for what dev/bench writes
+struct Value {
+    enum class Type {null, boolean, number, string, array, object};
+
+    Type type {Type::null};
+    double number {0.0};
+    std::string str;
+    std::vector<Value> items;
+    std::vector<std::pair<std::string, Value>> members; // in file order
+
+    const Value* get(std::string_view key) const
+    {
+        for (const auto& member : members) {
+            if (member.first == key) { return &member.second; }
+        }
+        return nullptr;
+    }
+};
+
+class Parser final {
+public:
+    explicit Parser(std::string_view text): text {text} {}
+
+    bool parse(Value& v)
+    {
+        return value(v) && (skip_space(), pos == text.size());
+    }
+
+    std::size_t position() const { return pos; }
+
+private:
+    void skip_space()
+    {
+        while (pos < text.size() &&
+               (text[pos] == ' ' || text[pos] == '\n' ||
+                text[pos] == '\r' || text[pos] == '\t'))
+        {
+            ++pos;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skip_space();
+        if (pos < text.size() && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(std::string_view word)
+    {
+        if (text.substr(pos, word.size()) != word) { return false; }
+        pos += word.size();
+        return true;
+    }
+
+    bool string(std::string& str)
+    {
+        if (!consume('"')) { return false; }
+        while (pos < text.size() && text[pos] != '"') {
+            char c {text[pos++]};
+            if (c == '\\') {
+                if (pos == text.size()) { return false; }
+                c = text[pos++];
+                switch (c) {
+                    case 'n': c = '\n'; break;
+                    case 't': c = '\t'; break;
+                    case '"': case '\\': case '/': break;
+                    default: return false; // \u and friends aren't written
+                }
+            }
+            str += c;
+        }
+        return pos++ < text.size();
+    }
+
+    bool value(Value& v)
+    {
+        skip_space();
+        if (pos == text.size()) { return false; }
+
+        const char c {text[pos]};
+        if (c == '{') {
+            v.type = Value::Type::object;
+            ++pos;
+            if (consume('}')) { return true; }
+            do {
+                std::string key;
+                Value member;
+                if (!string(key) || !consume(':') || !value(member)) {
+                    return false;
+                }
+                v.members.emplace_back(std::move(key), std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            v.type = Value::Type::array;
+            ++pos;
+            if (consume(']')) { return true; }
+            do {
+                v.items.emplace_back();
+                if (!value(v.items.back())) { return false; }
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            v.type = Value::Type::string;
+            return string(v.str);
+        }
+        if (literal("true")) {
+            v.type = Value::Type::boolean;
+            v.number = 1.0;
+            return true;
+        }
+        if (literal("false")) {
+            v.type = Value::Type::boolean;
+            return true;
+        }
+        if (literal("null")) { return true; }
+
+        const std::string rest {text.substr(pos, 64)};
+        char* end;
+        v.number = std::strtod(rest.c_str(), &end);
+        if (end == rest.c_str()) { return false; }
+        v.type = Value::Type::number;
+        pos += end - rest.c_str();
+        return true;
+    }
+
+    std::string_view text;
+    std::size_t pos {0};
+};
+
+bool load(const char* path, Value& doc)
+{
+    std::ifstream in {path};
+    if (!in) {
+        std::cerr << "can not read " << path << std::endl;
+        return false;
+    }
+    const std::string text {
+        std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+
+    Parser parser {text};
+    if (!parser.parse(doc) || doc.type != Value::Type::object) {
+        std::cerr << path << ": bad JSON near byte " << parser.position()
+                  << std::endl;
+        return false;
+    }
+    const Value* benchmarks {doc.get("benchmarks")};
+    if (benchmarks == nullptr || benchmarks->type != Value::Type::array) {
+        std::cerr << path << ": no \"benchmarks\" array" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// benchmarks by name
+std::map<std::string, const Value*> index(const Value& doc)
+{
+    std::map<std::string, const Value*> by_name;
+    const Value* benchmarks {doc.get("benchmarks")};
+    if (benchmarks == nullptr) { return by_name; }
+    for (const Value& bench : benchmarks->items) {
+        const Value* name {bench.get("name")};
+        if (name != nullptr && name->type == Value::Type::string) {
+            by_name[name->str] = &bench;
+        }
+    }
+    return by_name;
+}
+
+// metric -> percent, the benchmark's own override the global ones
+std::map<std::string, double> thresholds(
+    const Value& baseline,
+    const Value& bench)
+{
+    std::map<std::string, double> result;
+    if (baseline.get("thresholds") == nullptr) {
+        result = default_thresholds;
+    }
+    for (const Value* src : {baseline.get("thresholds"),
+                             bench.get("thresholds")})
+    {
+        if (src == nullptr) { continue; }
+        for (const auto& [metric, percent] : src->members) {
+            if (percent.type == Value::Type::number) {
+                result[metric] = percent.number;
+            }
+        }
+    }
+    return result;
+}
+
+bool number(const Value& bench, const std::string& metric, double& out)
+{
+    const Value* v {bench.get(metric)};
+    if (v == nullptr || v->type != Value::Type::number) { return false; }
+    out = v->number;
+    return true;
+}
+
+int compare(const Value& baseline, const Value& results)
+{
+    const auto base_by_name {index(baseline)};
+    const auto res_by_name {index(results)};
+
+    std::cout << std::left << std::setw(22) << "benchmark"
+              << std::setw(8) << "metric" << std::right
+              << std::setw(12) << "baseline" << std::setw(12) << "now"
+              << std::setw(10) << "change" << std::setw(10) << "limit"
+              << std::endl;
+
+    int regressions {0};
+    for (const auto& [name, bench] : res_by_name) {
+        const auto base_it {base_by_name.find(name)};
+        if (base_it == base_by_name.end()) {
+            std::cout << std::left << std::setw(22) << name
+                      << "not in the baseline" << std::endl;
+            continue;
+        }
+
+        const Value& base {*base_it->second};
+        for (const auto& [metric, limit] : thresholds(baseline, base)) {
+            double before;
+            double now;
+            if (!number(base, metric, before) ||
+                !number(*bench, metric, now) || before <= 0.0)
+            {
+                std::cout << std::left << std::setw(22) << name
+                          << std::setw(8) << metric << "missing" << std::endl;
+                continue;
+            }
+
+            const double change {(now - before) / before * 100.0};
+            const bool regressed {change > limit};
+            regressions += regressed;
+            std::cout << std::left << std::setw(22) << name
+                      << std::setw(8) << metric << std::right << std::fixed
+                      << std::setprecision(1)
+                      << std::setw(12) << before << std::setw(12) << now
+                      << std::setw(9) << std::showpos << change << '%'
+                      << std::noshowpos << std::setw(9) << limit << '%'
+                      << (regressed ? "  REGRESSED" :
+                          change < -limit ? "  faster" : "")
+                      << std::endl;
+        }
+    }
+    for (const auto& [name, bench] : base_by_name) {
+        if (res_by_name.count(name) == 0) {
+            std::cout << std::left << std::setw(22) << name
+                      << "not in the results" << std::endl;
+        }
+    }
+
+    if (regressions > 0) {
+        std::cout << regressions << " regression(s) past the thresholds"
+                  << std::endl;
+        return 1;
+    }
+    std::cout << "no regressions" << std::endl;
+
+    return 0;
+}
+
+void write_thresholds(std::ostream& out, const Value& thresholds)
+{
+    out << "{";
+    for (std::size_t i {0}; i < thresholds.members.size(); ++i) {
+        out << (i == 0 ? "" : ", ") << '"' << thresholds.members[i].first
+            << "\": " << thresholds.members[i].second.number;
+    }
+    out << "}";
+}
+
+// the results' numbers with the baseline's thresholds
+int update(const char* path, const Value& baseline, const Value& results)
+{
+    const auto base_by_name {index(baseline)};
+
+    std::ostringstream out;
+    out << std::defaultfloat;
+    const Value* version {results.get("version")};
+    out << "{\n  \"version\": \""
+        << (version != nullptr ? version->str : "") << "\",\n"
+        << "  \"unit\": \"ns\",\n  \"thresholds\": ";
+    const Value* global {baseline.get("thresholds")};
+    if (global != nullptr) {
+        write_thresholds(out, *global);
+    } else {
+        Value defaults;
+        for (const auto& [metric, percent] : default_thresholds) {
+            Value v;
+            v.type = Value::Type::number;
+            v.number = percent;
+            defaults.members.emplace_back(metric, v);
+        }
+        write_thresholds(out, defaults);
+    }
+    out << ",\n  \"benchmarks\": [";
+
+    const auto& benchmarks {results.get("benchmarks")->items};
+    for (std::size_t i {0}; i < benchmarks.size(); ++i) {
+        const Value& bench {benchmarks[i]};
+        const Value* name {bench.get("name")};
+        if (name == nullptr) { continue; }
+
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << name->str
+            << '"';
+        for (const auto& [key, v] : bench.members) {
+            if (v.type == Value::Type::number) {
+                out << ", \"" << key << "\": " << v.number;
+            }
+        }
+        const auto base_it {base_by_name.find(name->str)};
+        if (base_it != base_by_name.end()) {
+            const Value* own {base_it->second->get("thresholds")};
+            if (own != nullptr) {
+                out << ", \"thresholds\": ";
+                write_thresholds(out, *own);
+            }
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+
+    std::ofstream file {path};
+    if (!(file << out.str())) {
+        std::cerr << "can not write " << path << std::endl;
+        return 2;
+    }
+    std::cout << "updated " << path << std::endl;
+
+    return 0;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const bool update_mode {
+        argc > 1 && std::string_view{argv[1]} == "--update"};
+    const int first {update_mode ? 2 : 1};
+    if (argc - first < 2) {
+        std::cerr << "usage: " << argv[0]
+                  << " [--update] <baseline.json> <results.json>..."
+                  << std::endl;
+        return 2;
+    }
+    const char* baseline_path {argv[first]};
+
+    // the first results file with the benchmarks of the others appended
+    Value baseline;
+    Value results;
+    if (!load(argv[first + 1], results)) { return 2; }
+    Value* benchmarks {nullptr}; // there is one, load() checks
+    for (auto& member : results.members) {
+        if (member.first == "benchmarks") { benchmarks = &member.second; }
+    }
+    for (int i {first + 2}; i < argc; ++i) {
+        Value more;
+        if (!load(argv[i], more)) { return 2; }
+        for (const Value& bench : more.get("benchmarks")->items) {
+            benchmarks->items.push_back(bench);
+        }
+    }
+    if (!load(baseline_path, baseline)) {
+        if (!update_mode) { return 2; }
+        baseline = Value{}; // a new one with the default thresholds
+    }
+
+    return update_mode ?
+        update(baseline_path, baseline, results) :
+        compare(baseline, results);
+}
@@ -0,0 +1,204 @@
+/* Turns a binary log (written with --log-bin) into the text the game would
+ * have logged, or prints what a flight recorder file (--flight or a
+ * crash_<pid>.flight dump) holds: the last log records and frame samples.
+ *
+ * usage: logdecode <log.bin|file.flight>
+ *
+ * File layouts in src/log_format.hpp and src/flight_recorder.hpp. Files have
+ * to come from a machine with the same byte order, wall clock timestamps are
+ * shown in the local time of the machine decoding them. */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ios>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "flight_recorder.hpp"
+#include "log_format.hpp"
+#include "logs.hpp"
+
+namespace {
+struct Site_entry {
+    std::string file;
+    logs::Site site;
+};
+
+struct Decoder {
+    std::unordered_map<std::uint32_t, Site_entry> sites;
+    std::unordered_map<std::uint64_t, std::string> literals;
+};
+
+std::string_view find_literal(std::uint64_t addr, void* ctx)
+{
+    const auto& literals {static_cast<Decoder*>(ctx)->literals};
+    const auto it {literals.find(addr)};
+    if (it == literals.end()) { return "(unknown literal)"; }
+    return it->second;
+}
+
+template<typename T>
+bool read_value(std::istream& in, T& v)
+{
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(v)));
+}
+
+bool read_str(std::istream& in, std::string& str)
+{
+    std::uint16_t len;
+    if (!read_value(in, len)) { return false; }
+    str.resize(len);
+    return static_cast<bool>(in.read(str.data(), len));
+}
+
+// the chunks after the magic of a --log-bin file
+bool decode_log(std::istream& in)
+{
+    Decoder dec;
+    for (;;) {
+        const std::streamoff chunk_pos {in.tellg()};
+        logs::Bin_tag tag;
+        if (!read_value(in, tag)) { break; }
+
+        bool ok {false};
+        switch (tag) {
+            case logs::Bin_tag::site: {
+                std::uint32_t id;
+                Site_entry entry;
+                ok = read_value(in, id) && read_value(in, entry.site.line) &&
+                    read_value(in, entry.site.category) &&
+                    read_str(in, entry.file);
+                if (ok) { dec.sites[id] = std::move(entry); }
+            } break;
+            case logs::Bin_tag::literal: {
+                std::uint64_t addr;
+                std::string str;
+                ok = read_value(in, addr) && read_str(in, str);
+                if (ok) { dec.literals[addr] = std::move(str); }
+            } break;
+            case logs::Bin_tag::record: {
+                logs::Record rec;
+                ok = static_cast<bool>(in.read(
+                    reinterpret_cast<char*>(&rec),
+                    offsetof(logs::Record, payload)));
+                ok = ok && rec.size <= logs::Record::payload_size &&
+                    in.read(rec.payload, rec.size);
+                if (!ok) { break; }
+
+                logs::Site* site {nullptr};
+                if (const auto it {dec.sites.find(rec.site)};
+                    it != dec.sites.end())
+                {
+                    it->second.site.file = it->second.file.c_str();
+                    site = &it->second.site;
+                }
+                logs::format_record(rec, site, find_literal, &dec, std::cout);
+            } break;
+        }
+        if (!ok) {
+            // a log cut short by a crash ends with a partial chunk
+            std::cerr << "corrupt or truncated chunk at byte " << chunk_pos
+                      << ", stopping" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string_view no_literals(std::uint64_t, void*)
+{
+    return "(unknown literal)";
+}
+
+// memory of the flight recorder, as mapped or dumped on a crash
+bool decode_flight(std::istream& in)
+{
+    auto mem {std::make_unique<flight::Memory>()};
+    if (!in.read(reinterpret_cast<char*>(mem.get()), sizeof(*mem))) {
+        std::cerr << "truncated flight recorder file" << std::endl;
+        return false;
+    }
+    const flight::Header& hdr {mem->header};
+    if (hdr.record_capacity != flight::record_capacity ||
+        hdr.frame_capacity != flight::frame_capacity)
+    {
+        std::cerr << "flight recorder file from a different version"
+                  << std::endl;
+        return false;
+    }
+
+    std::cout << "pid " << hdr.pid << ", ";
+    if (hdr.crash_signal != 0) {
+        std::cout << "died of signal " << hdr.crash_signal << " ("
+                  << strsignal(hdr.crash_signal) << ")\n";
+    } else {
+        std::cout << "no crash recorded (running, killed or exited)\n";
+    }
+
+    std::cout << "last " << std::min<std::uint64_t>(
+        hdr.records_written, flight::record_capacity) << " of "
+              << hdr.records_written << " log records:\n";
+    const std::uint64_t first_rec {
+        hdr.records_written > flight::record_capacity ?
+        hdr.records_written - flight::record_capacity : 0};
+    for (std::uint64_t i {first_rec}; i < hdr.records_written; ++i) {
+        const logs::Record& rec {
+            mem->records[i % flight::record_capacity]};
+        if (rec.size > logs::Record::payload_size) { continue; } // torn
+        logs::format_record(rec, nullptr, no_literals, nullptr, std::cout);
+    }
+
+    std::cout << "last " << std::min<std::uint64_t>(
+        hdr.frames_written, flight::frame_capacity) << " of "
+              << hdr.frames_written << " frames:\n"
+              << "frame start_ms work_us ships rocks bullets\n";
+    const std::uint64_t first_frame {
+        hdr.frames_written > flight::frame_capacity ?
+        hdr.frames_written - flight::frame_capacity : 0};
+    const std::uint64_t t0 {
+        mem->frames[first_frame % flight::frame_capacity].start_ns};
+    for (std::uint64_t i {first_frame}; i < hdr.frames_written; ++i) {
+        const flight::Frame_sample& f {
+            mem->frames[i % flight::frame_capacity]};
+        std::cout << f.frame << " " << (f.start_ns - t0) / 1000000.0 << " "
+                  << f.work_ns / 1000.0 << " " << f.ships << " " << f.rocks
+                  << " " << f.bullets << "\n";
+    }
+
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::cerr << "usage: " << argv[0] << " <log.bin|file.flight>"
+                  << std::endl;
+        return 1;
+    }
+
+    std::ifstream in {argv[1], std::ios::binary};
+    char magic[sizeof(logs::bin_magic)];
+    if (!in.read(magic, sizeof(magic))) {
+        std::cerr << "can not read " << argv[1] << std::endl;
+        return 1;
+    }
+    if (std::memcmp(magic, logs::bin_magic, sizeof(magic)) == 0) {
+        return decode_log(in) ? 0 : 1;
+    }
+    if (std::memcmp(magic, flight::magic, sizeof(magic)) == 0) {
+        in.seekg(0);
+        return decode_flight(in) ? 0 : 1;
+    }
+    std::cerr << argv[1] << " is neither a binary log nor a flight recorder"
+              << " file" << std::endl;
+
+    return 1;
+}
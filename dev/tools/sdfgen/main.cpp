@@ -0,0 +1,193 @@
+/* Makes a signed distance field font atlas out of a bitmap one.
+ *
+ * usage: sdfgen <in.ktx2> <out.ktx2> [scale] [spread]
+ *
+ * The input is one of the bitmap atlases in gfx/fonts (glyph range and layout
+ * as in src/font_atlas.hpp). Each glyph cell is upscaled by 'scale' and every
+ * output texel stores the distance to the nearest glyph edge, 0.5 (128) being
+ * the edge itself, 1.0 being 'spread' source pixels inside the glyph and 0.0
+ * as far outside. Distances are only measured within a glyph's own cell so
+ * neighbours never bleed into each other.
+ *
+ * The output is a one-channel R8_UNORM KTX2 with ZLIB supercompression. */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <ktx.h>
+
+#include "font_atlas.hpp"
+
+namespace {
+constexpr ktx_uint32_t vk_format_r8_unorm {9};
+
+struct Bitmap {
+    int w;
+    int h;
+    std::vector<bool> px; // true where inside a glyph
+};
+
+// distance from point (x, y) to the unit square of pixel (px, py)
+float dist_to_px(float x, float y, int px, int py)
+{
+    const float dx {std::max({px - x, 0.0f, x - (px + 1)})};
+    const float dy {std::max({py - y, 0.0f, y - (py + 1)})};
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+std::vector<std::uint8_t> make_sdf(const Bitmap& src, int scale, float spread)
+{
+    const int out_w {src.w * scale};
+    const int out_h {src.h * scale};
+    const int reach {static_cast<int>(std::ceil(spread))};
+    std::vector<std::uint8_t> out(out_w * out_h);
+
+    for (int oy {0}; oy < out_h; ++oy) {
+        for (int ox {0}; ox < out_w; ++ox) {
+            // texel centre in source pixel coordinates
+            const float x {(ox + 0.5f) / scale};
+            const float y {(oy + 0.5f) / scale};
+            const int sx {ox / scale};
+            const int sy {oy / scale};
+            const bool inside {src.px[sy * src.w + sx]};
+
+            const int cell_x0 {sx / font_atlas::glyph_w * font_atlas::glyph_w};
+            const int cell_y0 {sy / font_atlas::glyph_h * font_atlas::glyph_h};
+
+            // nearest pixel of the opposite kind, outside the cell is empty
+            float nearest {spread};
+            for (int py {sy - reach}; py <= sy + reach; ++py) {
+                for (int px {sx - reach}; px <= sx + reach; ++px) {
+                    const bool in_cell {
+                        px >= cell_x0 && px < cell_x0 + font_atlas::glyph_w &&
+                        py >= cell_y0 && py < cell_y0 + font_atlas::glyph_h};
+                    const bool px_inside {in_cell && src.px[py * src.w + px]};
+                    if (px_inside != inside) {
+                        nearest = std::min(nearest, dist_to_px(x, y, px, py));
+                    }
+                }
+            }
+
+            const float d {inside ? nearest : -nearest};
+            const float v {std::clamp(0.5f + d / (2 * spread), 0.0f, 1.0f)};
+            out[oy * out_w + ox] =
+                static_cast<std::uint8_t>(std::lround(v * 255));
+        }
+    }
+
+    return out;
+}
+
+bool load_bitmap(const char* path, Bitmap& bmp)
+{
+    ktxTexture2* tex;
+    KTX_error_code result {ktxTexture2_CreateFromNamedFile(
+        path, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &tex)};
+    if (result != KTX_SUCCESS) {
+        std::cerr << "can not load " << path << ": "
+                  << ktxErrorString(result) << std::endl;
+        return false;
+    }
+
+    ktx_uint32_t components {ktxTexture2_GetNumComponents(tex)};
+    if (ktxTexture2_NeedsTranscoding(tex)) {
+        result = ktxTexture2_TranscodeBasis(tex, KTX_TTF_RGBA32, 0);
+        components = 4;
+    }
+    if (result != KTX_SUCCESS || tex->isCompressed) {
+        std::cerr << "unsupported texture format in " << path << std::endl;
+        ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(tex));
+        return false;
+    }
+
+    // coverage is in alpha for RGBA atlases, the only channel for R8 ones
+    const ktx_uint8_t* data {
+        ktxTexture_GetData(reinterpret_cast<ktxTexture*>(tex))};
+    bmp.w = tex->baseWidth;
+    bmp.h = tex->baseHeight;
+    bmp.px.resize(bmp.w * bmp.h);
+    for (int i {0}; i < bmp.w * bmp.h; ++i) {
+        bmp.px[i] = data[i * components + (components - 1)] > 127;
+    }
+    ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(tex));
+
+    if (bmp.w != font_atlas::columns * font_atlas::glyph_w ||
+        bmp.h != font_atlas::rows * font_atlas::glyph_h)
+    {
+        std::cerr << "unexpected atlas size " << bmp.w << "x" << bmp.h
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool save_sdf(const char* path, int w, int h, std::vector<std::uint8_t>& data)
+{
+    ktxTextureCreateInfo info {};
+    info.vkFormat = vk_format_r8_unorm;
+    info.baseWidth = w;
+    info.baseHeight = h;
+    info.baseDepth = 1;
+    info.numDimensions = 2;
+    info.numLevels = 1;
+    info.numLayers = 1;
+    info.numFaces = 1;
+    info.isArray = KTX_FALSE;
+    info.generateMipmaps = KTX_FALSE;
+
+    ktxTexture2* tex;
+    KTX_error_code result {
+        ktxTexture2_Create(&info, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &tex)};
+    if (result == KTX_SUCCESS) {
+        result = ktxTexture_SetImageFromMemory(
+            reinterpret_cast<ktxTexture*>(tex), 0, 0, 0,
+            data.data(), data.size());
+    }
+    if (result == KTX_SUCCESS) { result = ktxTexture2_DeflateZLIB(tex, 9); }
+    if (result == KTX_SUCCESS) {
+        result = ktxTexture_WriteToNamedFile(
+            reinterpret_cast<ktxTexture*>(tex), path);
+    }
+    if (result != KTX_SUCCESS) {
+        std::cerr << "can not write " << path << ": "
+                  << ktxErrorString(result) << std::endl;
+    }
+    ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(tex));
+
+    return result == KTX_SUCCESS;
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::cerr << "usage: " << argv[0]
+                  << " <in.ktx2> <out.ktx2> [scale] [spread]" << std::endl;
+        return 1;
+    }
+    const int scale {argc > 3 ? std::atoi(argv[3]) : 4};
+    const float spread {
+        argc > 4 ? static_cast<float>(std::atof(argv[4])) : 2.0f};
+    if (scale < 1 || spread <= 0.0f) {
+        std::cerr << "scale must be >= 1 and spread > 0" << std::endl;
+        return 1;
+    }
+
+    Bitmap bmp;
+    if (!load_bitmap(argv[1], bmp)) { return 1; }
+
+    std::cout << "glyphs " << int{font_atlas::first_char} << "-"
+              << int{font_atlas::last_char} << ", " << bmp.w << "x" << bmp.h
+              << " -> " << bmp.w * scale << "x" << bmp.h * scale
+              << ", spread " << spread << " px" << std::endl;
+
+    std::vector<std::uint8_t> sdf {make_sdf(bmp, scale, spread)};
+    if (!save_sdf(argv[2], bmp.w * scale, bmp.h * scale, sdf)) { return 1; }
+
+    return 0;
+}
@@ -0,0 +1,20 @@
+#version 330 core
+
+out vec4 color;
+
+in vec3 frag_color;
+in vec2 frag_tex_coord;
+
+/* signed distance field atlas (see dev/tools/sdfgen), 0.5 is the glyph edge,
+   one-channel textures are swizzled to (1, 1, 1, R) on load */
+uniform sampler2D sampler1;
+
+void main()
+{
+	float dist = texture(sampler1, frag_tex_coord).a;
+	// anti-alias over about one screen pixel, whatever the text size
+	float width = fwidth(dist);
+	float alpha = smoothstep(0.5 - width, 0.5 + width, dist);
+
+	color = vec4(frag_color, alpha);
+}
@@ -0,0 +1,25 @@
+#include "Collision_grid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#include "utils.hpp"
+
+void Collision_grid::reset(const Boxf& area, float cell_size)
+{
+    this->area = area;
+    inv_cell_size = 1.0f / cell_size;
+    cols = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::ceil(area.w * inv_cell_size)));
+    rows = std::max<std::size_t>(
+        1, static_cast<std::size_t>(std::ceil(area.h * inv_cell_size)));
+    cell_start.assign(cell_count() + 1, 0);
+    items.clear();
+}
+
+void Collision_grid::reserve(std::size_t count)
+{
+    items.reserve(count);
+    item_cell.reserve(count);
+}
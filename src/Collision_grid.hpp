@@ -0,0 +1,106 @@
+#ifndef SRC_COLLISION_GRID_HPP_
+#define SRC_COLLISION_GRID_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+/*******************************************************************************
+ * Uniform grid broadphase.
+ *
+ * Circles are binned by their center into square cells at least as large as
+ * the biggest radius, so anything touching a point is in the 3x3 cells around
+ * it. Building is a counting sort into one flat index array: two passes over
+ * the items and no allocation once the arrays have grown to the largest
+ * count seen. Positions outside the area go into the border cells.
+ ******************************************************************************/
+
+class Collision_grid final {
+public:
+    // forgets the items, 'cell_size' has to be >= the largest radius
+    void reset(const Boxf& area, float cell_size);
+
+    // grows the arrays for 'count' items up front, after reset()
+    void reserve(std::size_t count);
+
+    /* 'pos_of(i)' gives item i's position (anything with x and y), items
+       are then referred to by their index */
+    template<typename Pos_of>
+    void build(std::size_t count, Pos_of pos_of);
+
+    // calls 'fn(i)' for each item in the cells around (x, y)
+    template<typename Fn>
+    void query(float x, float y, Fn fn) const;
+
+    std::size_t cell_count() const { return cols * rows; }
+
+private:
+    std::size_t cell_of(float x, float y) const;
+
+    Boxf area {0.0f, 0.0f, 0.0f, 0.0f};
+    float inv_cell_size {1.0f};
+    std::size_t cols {0};
+    std::size_t rows {0};
+    std::vector<std::uint32_t> cell_start; // cell_count + 1, into items
+    std::vector<std::uint32_t> items;
+    std::vector<std::uint32_t> item_cell; // scratch for build()
+};
+
+inline std::size_t Collision_grid::cell_of(float x, float y) const
+{
+    const float fx {(x - area.x) * inv_cell_size};
+    const float fy {(y - area.y) * inv_cell_size};
+    const std::size_t cx {
+        fx <= 0.0f ? 0 :
+        fx >= cols - 1 ? cols - 1 : static_cast<std::size_t>(fx)};
+    const std::size_t cy {
+        fy <= 0.0f ? 0 :
+        fy >= rows - 1 ? rows - 1 : static_cast<std::size_t>(fy)};
+    return cy * cols + cx;
+}
+
+template<typename Pos_of>
+void Collision_grid::build(std::size_t count, Pos_of pos_of)
+{
+    cell_start.assign(cell_count() + 1, 0);
+    item_cell.resize(count);
+    items.resize(count);
+
+    for (std::size_t i {0}; i < count; ++i) {
+        const auto& pos {pos_of(i)};
+        item_cell[i] = static_cast<std::uint32_t>(cell_of(pos.x, pos.y));
+        ++cell_start[item_cell[i]];
+    }
+    // ends of the cells, the last entry becomes 'count'
+    for (std::size_t c {1}; c < cell_start.size(); ++c) {
+        cell_start[c] += cell_start[c - 1];
+    }
+    // fills the cells back to front, leaving cell_start at their starts
+    for (std::size_t i {count}; i-- > 0;) {
+        items[--cell_start[item_cell[i]]] = static_cast<std::uint32_t>(i);
+    }
+}
+
+template<typename Fn>
+void Collision_grid::query(float x, float y, Fn fn) const
+{
+    if (items.empty()) { return; }
+
+    const std::size_t center {cell_of(x, y)};
+    const std::size_t cx {center % cols};
+    const std::size_t cy {center / cols};
+    const std::size_t x_end {cx + 1 < cols ? cx + 2 : cols};
+    const std::size_t y_end {cy + 1 < rows ? cy + 2 : rows};
+    for (std::size_t row {cy > 0 ? cy - 1 : 0}; row < y_end; ++row) {
+        const std::size_t first {row * cols + (cx > 0 ? cx - 1 : 0)};
+        const std::size_t last {row * cols + x_end};
+        // the cells of a row are next to each other in 'items'
+        for (std::uint32_t i {cell_start[first]}; i < cell_start[last]; ++i) {
+            fn(items[i]);
+        }
+    }
+}
+
+#endif // SRC_COLLISION_GRID_HPP_
@@ -0,0 +1,68 @@
+#include "File_watcher.hpp"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "logs.hpp"
+
+File_watcher::~File_watcher()
+{
+    if (fd != -1) { close(fd); }
+}
+
+bool File_watcher::watch_dir(const std::string& dir)
+{
+    if (fd == -1) {
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd == -1) {
+            ERR("inotify_init1 failed: ", std::strerror(errno));
+            return false;
+        }
+    }
+
+    /* editors either write the file in place or write a temporary file and
+       rename it over the original, the latter only shows up as IN_MOVED_TO */
+    int wd {inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO)};
+    if (wd == -1) {
+        ERR("can not watch ", dir, ": ", std::strerror(errno));
+        return false;
+    }
+    watches.push_back(Watch{wd, dir});
+    DBG_CAT(logs::Category::assets, 1, "watching ", dir);
+
+    return true;
+}
+
+void File_watcher::poll(std::vector<std::string>& changed)
+{
+    if (fd == -1) { return; }
+
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t len {read(fd, buf, sizeof(buf))};
+        if (len <= 0) {
+            if (len == -1 && errno != EAGAIN) {
+                ERR("inotify read failed: ", std::strerror(errno));
+            }
+            return;
+        }
+
+        for (ssize_t i {0}; i < len;) {
+            const auto* ev {reinterpret_cast<const inotify_event*>(&buf[i])};
+            i += sizeof(inotify_event) + ev->len;
+            if (ev->len == 0) { continue; }
+
+            for (const auto& watch : watches) {
+                if (watch.wd == ev->wd) {
+                    changed.push_back(watch.dir + "/" + ev->name);
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef SRC_FILE_WATCHER_HPP_
+#define SRC_FILE_WATCHER_HPP_
+
+#include <string>
+#include <vector>
+
+/* Reports files that were written to in watched directories (inotify).
+ * Polling never blocks, it is meant to be called once per frame. */
+class File_watcher final {
+public:
+    File_watcher() = default;
+    ~File_watcher();
+
+    File_watcher(const File_watcher&) = delete;
+    File_watcher& operator=(const File_watcher&) = delete;
+
+    // start watching 'dir' (not recursive), returns false on error
+    bool watch_dir(const std::string& dir);
+
+    /* appends paths ("dir/name") of files finished being written or moved into
+       a watched directory since the last call, may contain duplicates */
+    void poll(std::vector<std::string>& changed);
+
+private:
+    struct Watch {
+        int wd;
+        std::string dir;
+    };
+
+    int fd {-1};
+    std::vector<Watch> watches;
+};
+
+#endif // SRC_FILE_WATCHER_HPP_
@@ -0,0 +1,60 @@
+#ifndef SRC_FIXED_VECTOR_HPP_
+#define SRC_FIXED_VECTOR_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/*******************************************************************************
+ * Vector of at most N elements stored inline.
+ *
+ * Never allocates, and a Fixed_vector of trivially copyable elements is itself
+ * trivially copyable, so whatever contains it can be copied with one memcpy.
+ * The unused capacity is left uninitialized. push_back() on a full one does
+ * nothing and returns false, what doesn't fit is up to the caller.
+ ******************************************************************************/
+
+template<typename T, std::size_t N>
+class Fixed_vector final {
+public:
+    static constexpr std::size_t capacity() { return N; }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == N; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    T* begin() { return items; }
+    const T* begin() const { return items; }
+    T* end() { return items + count; }
+    const T* end() const { return items + count; }
+
+    T& operator[](std::size_t i) { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+    T& back() { return items[count - 1]; }
+    const T& back() const { return items[count - 1]; }
+
+    bool push_back(const T& item)
+    {
+        if (count == N) { return false; }
+        items[count++] = item;
+        return true;
+    }
+
+    void pop_back() { --count; }
+    void clear() { count = 0; }
+
+    // new elements are copies of 'item', 'n' is cut to the capacity
+    void resize(std::size_t n, const T& item)
+    {
+        if (n > N) { n = N; }
+        for (std::size_t i {count}; i < n; ++i) { items[i] = item; }
+        count = static_cast<std::uint32_t>(n);
+    }
+
+private:
+    std::uint32_t count {0};
+    T items[N];
+};
+
+#endif // SRC_FIXED_VECTOR_HPP_
@@ -0,0 +1,166 @@
+#include "Frame_stats.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "logs.hpp"
+#include "version.hpp"
+
+Frame_stats::~Frame_stats()
+{
+    if (csv != nullptr) { std::fclose(csv); }
+}
+
+void Frame_stats::init(int argc, char** argv, const char* name)
+{
+    const char* path {std::getenv("RNB_FRAME_CSV")};
+    const char* json {std::getenv("RNB_FRAME_JSON")};
+    for (int i {1}; i < argc; ++i) {
+        const std::string_view arg {argv[i]};
+        if (arg == "--frame-csv" && i + 1 < argc) {
+            path = argv[++i];
+        } else if (arg == "--frame-json" && i + 1 < argc) {
+            json = argv[++i];
+        }
+    }
+    json_name = name;
+    if (json != nullptr) { json_path = json; }
+    if (path == nullptr) { return; }
+
+    csv = std::fopen(path, "w");
+    if (csv == nullptr) {
+        ERR("can not open frame CSV ", path, ": ",
+            std::strerror(errno));
+        return;
+    }
+    std::fputs("frame,interval_ms,cpu_ms,gpu_ms,pacing_error_ms\n", csv);
+    INFO("writing frame samples to ", path);
+}
+
+void Frame_stats::add(const Sample& sample)
+{
+    const bool has_gpu {sample.gpu_ms != no_gpu};
+    const bool paced {target_ms != unpaced};
+    const double error_ms {sample.interval_ms - target_ms};
+    interval.add(sample.interval_ms);
+    cpu.add(sample.cpu_ms);
+    if (has_gpu) { gpu.add(sample.gpu_ms); }
+    if (paced) { pacing_error.add(std::abs(error_ms)); }
+
+    if (csv != nullptr) {
+        std::fprintf(csv, "%llu,%.4f,%.4f,",
+                     static_cast<unsigned long long>(frames),
+                     sample.interval_ms, sample.cpu_ms);
+        if (has_gpu) { std::fprintf(csv, "%.4f", sample.gpu_ms); }
+        std::fputc(',', csv);
+        if (paced) { std::fprintf(csv, "%.4f", error_ms); }
+        std::fputc('\n', csv);
+    }
+    ++frames;
+}
+
+void Frame_stats::report() const
+{
+    if (frames == 0) { return; }
+    if (!json_path.empty()) { write_json(); }
+
+    if (target_ms != unpaced) {
+        INFO("frame stats over ", frames, " frames, target ",
+             target_ms, " ms (p50/p90/p99/p99.9/max)");
+    } else {
+        INFO("frame stats over ", frames,
+             " frames, unpaced (p50/p90/p99/p99.9/max)");
+    }
+    report("interval", interval);
+    report("cpu", cpu);
+    if (gpu.total() > 0) { report("gpu", gpu); }
+    if (pacing_error.total() > 0) { report("pacing error", pacing_error); }
+
+    const double low_ms {interval.worst_mean(0.01)};
+    const double avg_ms {interval.worst_mean(1.0)};
+    INFO("  fps avg ", avg_ms > 0.0 ? 1000.0 / avg_ms : 0.0,
+         ", 1% low ", low_ms > 0.0 ? 1000.0 / low_ms : 0.0);
+}
+
+bool Frame_stats::write_json() const
+{
+    std::FILE* file {std::fopen(json_path.c_str(), "w")};
+    if (file == nullptr) {
+        ERR("can not open frame JSON ", json_path, ": ",
+            std::strerror(errno));
+        return false;
+    }
+    std::fprintf(file,
+                 "{\n  \"version\": \"%s\",\n  \"unit\": \"ns\",\n"
+                 "  \"benchmarks\": [\n    {\"name\": \"%s\", "
+                 "\"frames\": %llu, \"min\": %.2f, \"mean\": %.2f, "
+                 "\"median\": %.2f, \"p99\": %.2f}\n  ]\n}\n",
+                 version_str().c_str(), json_name,
+                 static_cast<unsigned long long>(frames), cpu.min() * 1e6,
+                 cpu.mean() * 1e6, cpu.percentile(0.5) * 1e6,
+                 cpu.percentile(0.99) * 1e6);
+    const bool ok {std::fclose(file) == 0};
+    if (!ok) { ERR("can not write frame JSON ", json_path); }
+    return ok;
+}
+
+void Frame_stats::report(const char* name, const Histogram& hist) const
+{
+    INFO("  ", name, " ms: ", hist.percentile(0.5), " / ",
+         hist.percentile(0.9), " / ", hist.percentile(0.99), " / ",
+         hist.percentile(0.999), " / ", hist.max());
+}
+
+void Frame_stats::Histogram::add(double ms)
+{
+    const double bin {ms / bin_ms};
+    const std::size_t i {
+        bin < 0.0 ? 0 :
+        bin >= bins ? bins : static_cast<std::size_t>(bin)};
+    ++counts[i];
+    if (count == 0 || ms < min_ms) { min_ms = ms; }
+    ++count;
+    sum_ms += ms;
+    if (ms > max_ms) { max_ms = ms; }
+}
+
+double Frame_stats::Histogram::percentile(double p) const
+{
+    if (count == 0) { return 0.0; }
+
+    const auto rank {static_cast<std::uint64_t>(std::ceil(p * count))};
+    std::uint64_t seen {0};
+    for (std::size_t i {0}; i < bins; ++i) {
+        seen += counts[i];
+        // the bin's top, but never above a sample actually seen
+        if (seen >= rank) { return std::min((i + 1) * bin_ms, max_ms); }
+    }
+
+    return max_ms;
+}
+
+double Frame_stats::Histogram::worst_mean(double fraction) const
+{
+    const auto wanted {std::max<std::uint64_t>(
+        1, static_cast<std::uint64_t>(std::ceil(fraction * count)))};
+    if (count == 0) { return 0.0; }
+
+    // overflow samples are taken as the max, others as their bin's middle
+    std::uint64_t taken {std::min<std::uint64_t>(counts[bins], wanted)};
+    double sum {taken * max_ms};
+    for (std::size_t i {bins}; i-- > 0 && taken < wanted;) {
+        const std::uint64_t n {
+            std::min<std::uint64_t>(counts[i], wanted - taken)};
+        sum += n * (i + 0.5) * bin_ms;
+        taken += n;
+    }
+
+    return sum / taken;
+}
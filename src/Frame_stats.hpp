@@ -0,0 +1,97 @@
+#ifndef SRC_FRAME_STATS_HPP_
+#define SRC_FRAME_STATS_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/*******************************************************************************
+ * Frame time statistics.
+ *
+ * Every frame's interval (start to start), CPU time (update and draw without
+ * the sleep), GPU time and pacing error (how far the interval is off the
+ * target) go into fixed size histograms, so recording costs no allocation and
+ * a few increments no matter how long the game runs. report() logs the
+ * percentiles and the 1% lows at exit.
+ *
+ * With "--frame-csv <file>" (or RNB_FRAME_CSV) each frame's raw sample is
+ * also written to a CSV file as it comes in, with gpu_ms or pacing_error_ms
+ * empty where they are left out.
+ *
+ * With "--frame-json <file>" (or RNB_FRAME_JSON) report() also writes the CPU
+ * times in ns (min, mean, median, p99) as a benchmark in dev/bench's JSON
+ * form, so dev/tools/benchcmp can hold a whole frame loop against a baseline.
+ * The median and p99 have the histograms' resolution, the mean is exact.
+ ******************************************************************************/
+
+class Frame_stats final {
+public:
+    struct Sample final {
+        double interval_ms;
+        double cpu_ms;
+        double gpu_ms; // a few frames late, see Gpu_timer; or no_gpu
+    };
+    /* gpu_ms without a GPU time (headless, the server, the first frames
+       before Gpu_timer has results), left out */
+    static constexpr double no_gpu {-1.0};
+    // target_ms of a loop that runs as fast as it can, no pacing error then
+    static constexpr double unpaced {0.0};
+
+    explicit Frame_stats(double target_ms): target_ms {target_ms} {}
+    ~Frame_stats();
+
+    Frame_stats(const Frame_stats&) = delete;
+    Frame_stats& operator=(const Frame_stats&) = delete;
+
+    /* opens the CSV file if asked for on the command line or environment,
+       'name' is the benchmark's in the JSON file */
+    void init(int argc, char** argv, const char* name);
+
+    void add(const Sample& sample);
+
+    /* logs p50/p90/p99/p99.9 of every measure and the 1% low FPS, GPU time
+       only if there was any and pacing only with a target; writes the JSON
+       file if asked for */
+    void report() const;
+
+private:
+    class Histogram final {
+    public:
+        static constexpr double bin_ms {0.05};
+        static constexpr std::size_t bins {4000}; // up to 200 ms
+
+        void add(double ms);
+        // value below which 'p' (0-1) of the samples are, bin resolution
+        double percentile(double p) const;
+        // mean of the worst 'fraction' (0-1) of the samples
+        double worst_mean(double fraction) const;
+        std::uint64_t total() const { return count; }
+        double min() const { return count > 0 ? min_ms : 0.0; }
+        double mean() const { return count > 0 ? sum_ms / count : 0.0; }
+        double max() const { return max_ms; }
+
+    private:
+        std::array<std::uint32_t, bins + 1> counts {}; // last one is overflow
+        std::uint64_t count {0};
+        double min_ms {0.0};
+        double max_ms {0.0};
+        double sum_ms {0.0};
+    };
+
+    void report(const char* name, const Histogram& hist) const;
+    bool write_json() const;
+
+    double target_ms;
+    Histogram interval;
+    Histogram cpu;
+    Histogram gpu;
+    Histogram pacing_error; // absolute
+    std::FILE* csv {nullptr};
+    std::string json_path;
+    const char* json_name {""};
+    std::uint64_t frames {0};
+};
+
+#endif // SRC_FRAME_STATS_HPP_
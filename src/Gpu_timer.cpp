@@ -0,0 +1,109 @@
+#include "Gpu_timer.hpp"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+extern "C" {
+#include "timestamp.h"
+}
+
+Gpu_timer::~Gpu_timer()
+{
+    shutdown();
+}
+
+Gpu_timer::Pass_id Gpu_timer::add(std::string name)
+{
+    passes.push_back(Pass{});
+    passes.back().name = std::move(name);
+    return passes.size() - 1;
+}
+
+void Gpu_timer::begin_frame()
+{
+    if (!created) {
+        for (auto& pass : passes) {
+            for (auto& slot : pass.slots) {
+                glGenQueries(slot.queries.size(), slot.queries.data());
+            }
+        }
+        created = true;
+    }
+
+    frame_slot = (frame_slot + 1) % frames_in_flight;
+    for (auto& pass : passes) {
+        Slot& slot {pass.slots[frame_slot]};
+        if (!slot.issued) { continue; }
+
+        // the end query is the last one the GPU gets to
+        GLint available {GL_FALSE};
+        glGetQueryObjectiv(
+            slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE) { continue; }
+
+        GLuint64 t0 {0};
+        GLuint64 t1 {0};
+        glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &t1);
+        pass.last.gpu_ns = t1 - t0;
+        pass.last.cpu_ns = slot.cpu_ns;
+        slot.issued = false;
+    }
+}
+
+void Gpu_timer::begin(Pass_id id)
+{
+    Pass& pass {passes[id]};
+    pass.cpu_start_ns = timestamp_mono_ns();
+
+    // still waiting on the GPU from frames_in_flight frames ago, skip
+    if (pass.slots[frame_slot].issued) { return; }
+    glQueryCounter(pass.slots[frame_slot].queries[0], GL_TIMESTAMP);
+}
+
+void Gpu_timer::end(Pass_id id)
+{
+    Pass& pass {passes[id]};
+    Slot& slot {pass.slots[frame_slot]};
+    if (slot.issued) { return; }
+
+    glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+    slot.cpu_ns = timestamp_mono_ns() - pass.cpu_start_ns;
+    slot.issued = true;
+}
+
+std::size_t Gpu_timer::format(char* buf, std::size_t size) const
+{
+    if (size == 0) { return 0; }
+
+    std::size_t len {0};
+    for (const auto& pass : passes) {
+        if (len + 1 >= size) { break; }
+        const int n {std::snprintf(
+            buf + len, size - len, "%s%s %.2f/%.2f",
+            len == 0 ? "" : " ", pass.name.c_str(),
+            pass.last.gpu_ns / 1e6, pass.last.cpu_ns / 1e6)};
+        if (n < 0) { break; }
+        len += static_cast<std::size_t>(n);
+    }
+
+    return len < size ? len : size - 1;
+}
+
+void Gpu_timer::shutdown()
+{
+    if (!created) { return; }
+    for (auto& pass : passes) {
+        for (auto& slot : pass.slots) {
+            glDeleteQueries(slot.queries.size(), slot.queries.data());
+            slot.queries = {0, 0};
+            slot.issued = false;
+        }
+    }
+    created = false;
+}
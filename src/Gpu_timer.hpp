@@ -0,0 +1,84 @@
+#ifndef SRC_GPU_TIMER_HPP_
+#define SRC_GPU_TIMER_HPP_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+/*******************************************************************************
+ * GPU and CPU time per render pass.
+ *
+ * Each pass is bracketed by begin() / end(), which put GL_TIMESTAMP queries
+ * into the command stream and take the CPU time it took to submit the pass.
+ * Queries are kept in a ring of frames_in_flight frames and a frame's results
+ * are only read back when its slot comes around again, by then the GPU is long
+ * done with it and reading never stalls. Results are thus frames_in_flight
+ * frames old. If a result still isn't available the pass is not timed in that
+ * slot rather than waiting.
+ *
+ * Passes may nest or overlap, e.g. a whole frame pass around the others.
+ ******************************************************************************/
+
+class Gpu_timer final {
+public:
+    using Pass_id = std::size_t;
+    static constexpr std::size_t frames_in_flight {4};
+
+    struct Times final {
+        std::uint64_t gpu_ns {0};
+        std::uint64_t cpu_ns {0}; // submitting the pass, not executing it
+    };
+
+    Gpu_timer() = default;
+    ~Gpu_timer();
+
+    Gpu_timer(const Gpu_timer&) = delete;
+    Gpu_timer& operator=(const Gpu_timer&) = delete;
+
+    // all passes have to be added before the first begin_frame()
+    Pass_id add(std::string name);
+
+    /* reads back the results of the slot about to be reused, call once per
+       frame before any begin(), requires a current GL context */
+    void begin_frame();
+
+    void begin(Pass_id id);
+    void end(Pass_id id);
+
+    // latest results of a pass
+    const Times& times(Pass_id id) const { return passes[id].last; }
+    const std::string& name(Pass_id id) const { return passes[id].name; }
+    std::size_t size() const { return passes.size(); }
+
+    /* "name gpu/cpu ms" for every pass into 'buf', truncated to fit 'size',
+       returns the length written */
+    std::size_t format(char* buf, std::size_t size) const;
+
+    /* deletes the queries, has to come before the GL context is destroyed;
+       the destructor does it otherwise */
+    void shutdown();
+
+private:
+    struct Slot {
+        std::array<GLuint, 2> queries {0, 0}; // begin and end timestamps
+        bool issued {false};
+        std::uint64_t cpu_ns {0};
+    };
+
+    struct Pass {
+        std::string name;
+        std::array<Slot, frames_in_flight> slots;
+        std::uint64_t cpu_start_ns {0};
+        Times last;
+    };
+
+    std::vector<Pass> passes;
+    std::size_t frame_slot {0};
+    bool created {false};
+};
+
+#endif // SRC_GPU_TIMER_HPP_
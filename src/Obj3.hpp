@@ -7,19 +7,20 @@
 
 // generic 3d object model
 struct Model3 final {
-    std::vector<GLfloat> verts; // vertices
+    std::vector<float> verts; // vertices
     // can define more here as needed (normals, UVs, etc.)
 };
 
-// generic 3d object
+/* generic 3d object, plain data so the simulation state can be copied
+   with memcpy (no virtual functions here or in anything derived) */
 struct Obj3 {
+    Obj3() = default;
     Obj3(
         Model3* model,
         glm::vec3 pos,
         glm::vec3 front,
         glm::vec3 vel,
         glm::vec3 rot);
-    virtual ~Obj3(){};
 
     Model3* model;
     glm::vec3 pos; // position
@@ -28,7 +29,7 @@ struct Obj3 {
     glm::vec3 rot; // rotation
 };
 
-Obj3::Obj3(
+inline Obj3::Obj3(
     Model3* model,
     glm::vec3 pos,
     glm::vec3 front,
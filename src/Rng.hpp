@@ -0,0 +1,61 @@
+#ifndef SRC_RNG_HPP_
+#define SRC_RNG_HPP_
+
+#include <cstdint>
+
+/*******************************************************************************
+ * Small, fast pseudo random number generator (PCG32, XSH RR variant).
+ *
+ * Used instead of <random> wherever a run has to be reproducible: the standard
+ * distributions are implementation defined, so the same seed gives different
+ * numbers with a different standard library. The generator is 16 bytes of
+ * plain data and can be copied along with the state it's part of.
+ ******************************************************************************/
+
+class Rng final {
+public:
+    explicit Rng(std::uint64_t seed = 0) { reseed(seed); }
+
+    void reseed(std::uint64_t seed)
+    {
+        state = 0;
+        next();
+        state += seed;
+        next();
+    }
+
+    std::uint32_t next()
+    {
+        const std::uint64_t old {state};
+        state = old * 6364136223846793005ULL + increment;
+        const auto xorshifted {
+            static_cast<std::uint32_t>(((old >> 18u) ^ old) >> 27u)};
+        const auto rot {static_cast<std::uint32_t>(old >> 59u)};
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // [0, n), n > 0, slightly biased for huge n which is fine for games
+    std::uint32_t below(std::uint32_t n)
+    {
+        return static_cast<std::uint32_t>(
+            (static_cast<std::uint64_t>(next()) * n) >> 32);
+    }
+
+    // [0, 1)
+    float unit() { return (next() >> 8) * (1.0f / (1u << 24)); }
+
+    // [lo, hi)
+    float uniform(float lo, float hi) { return lo + (hi - lo) * unit(); }
+
+    bool chance(float p) { return unit() < p; }
+
+    std::uint64_t raw_state() const { return state; }
+    void set_raw_state(std::uint64_t raw) { state = raw; }
+
+private:
+    static constexpr std::uint64_t increment {1442695040888963407ULL};
+
+    std::uint64_t state;
+};
+
+#endif // SRC_RNG_HPP_
@@ -0,0 +1,29 @@
+#ifndef SRC_ROCK_HPP_
+#define SRC_ROCK_HPP_
+
+// drifts and spins around the arena until shot
+struct Rock final: public Obj3 {
+    Rock() = default;
+    Rock(
+        Model3* model,
+        glm::vec3 pos,
+        glm::vec3 vel,
+        float radius,
+        float spin);
+
+    float radius; // the model is of radius 1, scaled by this
+    float spin; // degrees per second around z
+};
+
+inline Rock::Rock(
+    Model3* model,
+    glm::vec3 pos,
+    glm::vec3 vel,
+    float radius,
+    float spin)
+: Obj3(model, pos, glm::vec3{0.0f, 1.0f, 0.0f}, vel, glm::vec3{0.0f})
+, radius {radius}
+, spin {spin}
+{}
+
+#endif // SRC_ROCK_HPP_
@@ -0,0 +1,152 @@
+#include "Rollback.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include "logs.hpp"
+#include "sim.hpp"
+#include "trace.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+constexpr std::uint64_t no_frame {std::numeric_limits<std::uint64_t>::max()};
+} // namespace
+
+Rollback::Rollback(sim::World& world, float dt)
+: world {world}
+, dt {dt}
+, players {world.players}
+, snapshots {max_prediction + 2}
+, inputs(players * history, Input{no_frame, 0})
+, used(history * players, 0)
+, confirmed_to(players, world.steps)
+, rollback_from {no_frame}
+, reported {world.steps}
+{
+    snapshots.save(world);
+}
+
+bool Rollback::set_input(
+    std::size_t player,
+    std::uint64_t frame,
+    std::uint8_t input)
+{
+    std::uint64_t& confirmed {confirmed_to[player]};
+    if (frame < confirmed) { return true; }
+    // the last confirmed input has to stay around for predictions
+    if (frame >= confirmed + history - 1) { return false; }
+
+    Input& slot {inputs[player * history + frame % history]};
+    if (slot.frame == frame) { return true; }
+    slot = Input{frame, input};
+    if (frame < world.steps &&
+        used[(frame % history) * players + player] != input)
+    {
+        rollback_from = std::min(rollback_from, frame);
+    }
+
+    while (inputs[player * history + confirmed % history].frame == confirmed) {
+        ++confirmed;
+    }
+    return true;
+}
+
+bool Rollback::can_advance() const
+{
+    return world.steps < min_confirmed() + max_prediction;
+}
+
+bool Rollback::advance()
+{
+    if (!can_advance()) {
+        ++totals.stalls;
+        return false;
+    }
+
+    if (rollback_from != no_frame) {
+        TRACE_SCOPE("rollback");
+        const std::uint64_t start_ns {timestamp_mono_ns()};
+        const std::uint64_t now {world.steps};
+        if (snapshots.restore(rollback_from, world)) {
+            const std::uint64_t depth {now - rollback_from};
+            while (world.steps < now) { simulate(); }
+            ++totals.rollbacks;
+            totals.resimulated += depth;
+            totals.max_depth = std::max(totals.max_depth, depth);
+            totals.rollback_ns += timestamp_mono_ns() - start_ns;
+            DBG_CAT(logs::Category::net, 2, "rolled back ", depth,
+                    " frames from ", now);
+        } else {
+            // can't happen while prediction stays within the snapshots
+            ERR("can not roll back to frame ", rollback_from,
+                ", snapshot is gone");
+        }
+        rollback_from = no_frame;
+    }
+
+    simulate();
+    ++totals.frames;
+    return true;
+}
+
+const sim::World* Rollback::next_confirmed(std::uint8_t* out)
+{
+    const std::uint64_t frame {reported};
+    if (frame >= min_confirmed() || frame >= world.steps ||
+        frame >= rollback_from)
+    {
+        return nullptr;
+    }
+    const sim::World* state {snapshots.find(frame + 1)};
+    if (state == nullptr) { return nullptr; }
+
+    std::copy_n(&used[(frame % history) * players], players, out);
+    ++reported;
+    return state;
+}
+
+void Rollback::report() const
+{
+    INFO("rollback: ", totals.frames, " frames, ", totals.stalls,
+         " waiting for input, ", totals.rollbacks, " rollbacks of ",
+         totals.resimulated, " frames (deepest ", totals.max_depth,
+         ")");
+    if (totals.rollbacks == 0) { return; }
+    const double ms {totals.rollback_ns / 1e6};
+    INFO("rollback: ", ms / totals.rollbacks, " ms each, ",
+         ms > 0.0 ? totals.resimulated * 1000.0 / ms : 0.0,
+         " frames/s resimulated");
+}
+
+std::uint64_t Rollback::min_confirmed() const
+{
+    return *std::min_element(confirmed_to.begin(), confirmed_to.end());
+}
+
+std::uint8_t Rollback::input_for(std::size_t player, std::uint64_t frame) const
+{
+    const Input* const player_inputs {&inputs[player * history]};
+    if (player_inputs[frame % history].frame == frame) {
+        return player_inputs[frame % history].input;
+    }
+    const std::uint64_t confirmed {confirmed_to[player]};
+    return confirmed == 0 ? 0 :
+        player_inputs[(confirmed - 1) % history].input;
+}
+
+void Rollback::simulate()
+{
+    const std::uint64_t frame {world.steps};
+    for (std::size_t p {0}; p < players; ++p) {
+        const std::uint8_t input {input_for(p, frame)};
+        used[(frame % history) * players + p] = input;
+        sim::apply_input(world, p, input, dt);
+    }
+    sim::step(world, dt);
+    snapshots.save(world);
+}
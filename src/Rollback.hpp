@@ -0,0 +1,99 @@
+#ifndef SRC_ROLLBACK_HPP_
+#define SRC_ROLLBACK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Snapshot_ring.hpp"
+#include "sim.hpp"
+
+/*******************************************************************************
+ * Runs a sim::World ahead on predicted input and corrects it once the real
+ * input is known, for networked play.
+ *
+ * Frame n is the step from World::steps n to n + 1. Each player's input for a
+ * frame is either confirmed with set_input() or predicted to be the same as
+ * the player's last confirmed one. advance() simulates the next frame with
+ * what is known and keeps a snapshot of every state. When confirmed input
+ * differs from what an already simulated frame used, the next advance() first
+ * restores the state before that frame and simulates from there again.
+ *
+ * Prediction goes at most max_prediction frames past the oldest unconfirmed
+ * input, advance() does nothing beyond that and the caller has to wait for
+ * input. States all input is confirmed for, the same on every peer, come out
+ * of next_confirmed(): those are the ones to record or hash.
+ ******************************************************************************/
+
+class Rollback final {
+public:
+    static constexpr std::size_t max_prediction {8};
+    // frames of input kept per player, confirmed input can be this far ahead
+    static constexpr std::size_t history {64};
+
+    struct Stats final {
+        std::uint64_t frames; // simulated for the first time
+        std::uint64_t stalls; // advance() waiting for input
+        std::uint64_t rollbacks;
+        std::uint64_t resimulated; // frames simulated again
+        std::uint64_t max_depth; // frames of the deepest rollback
+        std::uint64_t rollback_ns; // restoring and resimulating
+    };
+
+    Rollback(sim::World& world, float dt);
+
+    Rollback(const Rollback&) = delete;
+    Rollback& operator=(const Rollback&) = delete;
+
+    // the frame advance() simulates next
+    std::uint64_t frame() const { return world.steps; }
+
+    /* confirms 'player's input for 'frame', input confirmed before is kept;
+       false if 'frame' is too far ahead to be held */
+    bool set_input(std::size_t player, std::uint64_t frame, std::uint8_t input);
+
+    // frames of 'player's input confirmed from the start without a gap
+    std::uint64_t confirmed(std::size_t player) const
+    {
+        return confirmed_to[player];
+    }
+
+    bool can_advance() const;
+
+    /* rolls back if confirmed input says so, then simulates the next frame;
+       false (and nothing done) when too far ahead of confirmed input */
+    bool advance();
+
+    /* the next state all input is confirmed for, in order and each once, and
+       the inputs of the frame that led to it; nullptr if there is none yet.
+       Call until nullptr after every advance(), older ones are not kept */
+    const sim::World* next_confirmed(std::uint8_t* inputs);
+
+    const Stats& stats() const { return totals; }
+
+    // logs the stats, with the average cost of a rollback and frames/s
+    void report() const;
+
+private:
+    struct Input final {
+        std::uint64_t frame;
+        std::uint8_t input;
+    };
+
+    std::uint64_t min_confirmed() const;
+    std::uint8_t input_for(std::size_t player, std::uint64_t frame) const;
+    void simulate();
+
+    sim::World& world;
+    float dt;
+    std::size_t players;
+    Snapshot_ring snapshots;
+    std::vector<Input> inputs; // confirmed, players * history by frame
+    std::vector<std::uint8_t> used; // by the simulation, history * players
+    std::vector<std::uint64_t> confirmed_to; // per player
+    std::uint64_t rollback_from;
+    std::uint64_t reported {0}; // frames returned by next_confirmed()
+    Stats totals {};
+};
+
+#endif // SRC_ROLLBACK_HPP_
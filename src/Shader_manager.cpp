@@ -0,0 +1,298 @@
+#include "Shader_manager.hpp"
+
+#include <GL/glew.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "logs.hpp"
+#include "trace.hpp"
+#include "utils.hpp"
+
+namespace {
+// returns false if the shader did not compile, logs whatever the driver says
+bool check_shader(GLuint shader_id, const std::string& path)
+{
+    GLint result {GL_FALSE};
+    int info_log_length {0};
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+    glGetShaderiv(shader_id, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 0) {
+        std::vector<char> msg(info_log_length + 1);
+        glGetShaderInfoLog(shader_id, info_log_length, nullptr, &msg[0]);
+        if (result == GL_FALSE) {
+            ERR("could not compile shader ", path, ":\n", &msg[0]);
+        } else {
+            DBG_CAT(logs::Category::assets, 1,
+                    "shader ", path, " compile log:\n", &msg[0]);
+        }
+    } else if (result == GL_FALSE) {
+        ERR("could not compile shader ", path);
+    }
+
+    return result != GL_FALSE;
+}
+
+GLuint compile_shader(GLenum type, const std::string& code)
+{
+    GLuint shader_id {glCreateShader(type)};
+    const char* code_p {code.c_str()};
+    glShaderSource(shader_id, 1, &code_p, nullptr);
+    glCompileShader(shader_id);
+
+    return shader_id;
+}
+} // namespace
+
+Shader_manager::~Shader_manager()
+{
+    shutdown();
+}
+
+Shader_manager::Program_id Shader_manager::add(
+    const std::string& vert_path,
+    const std::string& frag_path,
+    std::vector<std::string> uniform_names)
+{
+    Shader_program prog;
+    prog.vert_path = vert_path;
+    prog.frag_path = frag_path;
+    prog.uniform_names = std::move(uniform_names);
+    programs.push_back(std::move(prog));
+
+    return programs.size() - 1;
+}
+
+bool Shader_manager::compile_all()
+{
+    TRACE_SCOPE("compile shaders");
+
+    /* let the driver pick how many threads it wants to use, without this the
+       extension is available but compiles may still happen serially */
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallel_compile = true;
+    } else if (GLEW_ARB_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallel_compile = true;
+    }
+    DBG_CAT(logs::Category::assets, 1,
+            "parallel shader compile: ", parallel_compile ? "yes" : "no");
+
+    bool ok {true};
+    for (auto& prog : programs) {
+        if (prog.state != Shader_program::State::queued) { continue; }
+        if (!issue(prog)) {
+            prog.state = Shader_program::State::failed;
+            ok = false;
+        }
+    }
+
+    /* linking only after every compile was issued, so the driver has all the
+       compile jobs in flight before it may need to wait on any of them */
+    for (auto& prog : programs) {
+        if (prog.state == Shader_program::State::compiling) { link(prog); }
+    }
+
+    return ok;
+}
+
+GLuint Shader_manager::get(Program_id id)
+{
+    Shader_program& prog {programs[id]};
+    if (prog.state == Shader_program::State::compiling) { finish(prog); }
+
+    return prog.state == Shader_program::State::ready ? prog.id : 0;
+}
+
+bool Shader_manager::is_ready(Program_id id) const
+{
+    const Shader_program& prog {programs[id]};
+    if (prog.state != Shader_program::State::compiling) { return true; }
+    return done(prog);
+}
+
+bool Shader_manager::watch(const std::string& dir)
+{
+    return watcher.watch_dir(dir);
+}
+
+void Shader_manager::update()
+{
+    TRACE_SCOPE("shader update");
+
+    changed_files.clear();
+    watcher.poll(changed_files);
+    for (const auto& path : changed_files) {
+        for (Program_id id {0}; id < programs.size(); ++id) {
+            if (programs[id].vert_path == path ||
+                programs[id].frag_path == path)
+            {
+                INFO("shader source changed: ", path);
+                reload(id);
+            }
+        }
+    }
+
+    for (std::size_t i {0}; i < reloads.size();) {
+        Reload& r {reloads[i]};
+        if (!done(r.prog)) {
+            ++i;
+            continue;
+        }
+
+        finish(r.prog);
+        if (r.prog.state == Shader_program::State::ready) {
+            Shader_program& live {programs[r.id]};
+            release(live);
+            live.id = r.prog.id;
+            live.uniform_locs.swap(r.prog.uniform_locs);
+            live.state = Shader_program::State::ready;
+            r.prog.id = 0;
+            INFO("shader program reloaded: ", live.vert_path, " ",
+                 live.frag_path);
+        } else {
+            ERR("shader reload failed, keeping the old program");
+        }
+
+        reloads[i] = std::move(reloads.back());
+        reloads.pop_back();
+    }
+}
+
+void Shader_manager::shutdown()
+{
+    for (auto& prog : programs) { release(prog); }
+    for (auto& r : reloads) { release(r.prog); }
+    reloads.clear();
+}
+
+bool Shader_manager::issue(Shader_program& prog)
+{
+    std::string vert_code;
+    std::string frag_code;
+    if (!read_text_file(prog.vert_path.c_str(), vert_code) ||
+        !read_text_file(prog.frag_path.c_str(), frag_code))
+    {
+        return false;
+    }
+
+    INFO("compiling shaders: ", prog.vert_path, " ", prog.frag_path);
+    prog.vert_id = compile_shader(GL_VERTEX_SHADER, vert_code);
+    prog.frag_id = compile_shader(GL_FRAGMENT_SHADER, frag_code);
+
+    prog.id = glCreateProgram();
+    if (prog.id == 0) {
+        ERR("could not create shader program");
+        release(prog);
+        return false;
+    }
+    prog.state = Shader_program::State::compiling;
+
+    return true;
+}
+
+void Shader_manager::link(Shader_program& prog)
+{
+    DBG_CAT(logs::Category::assets, 1,
+            "linking shader program: ", prog.vert_path, " ", prog.frag_path);
+    glAttachShader(prog.id, prog.vert_id);
+    glAttachShader(prog.id, prog.frag_id);
+    glLinkProgram(prog.id);
+}
+
+bool Shader_manager::done(const Shader_program& prog) const
+{
+    /* without the extension there's no way to ask, the driver most likely
+       did the work inside the compile/link calls already */
+    if (!parallel_compile) { return true; }
+
+    GLint status {GL_FALSE};
+    glGetProgramiv(prog.id, GL_COMPLETION_STATUS_KHR, &status);
+
+    return status != GL_FALSE;
+}
+
+void Shader_manager::finish(Shader_program& prog)
+{
+    // blocks until the driver is done if it isn't yet
+    TRACE_SCOPE("finish shader program");
+
+    bool ok {check_shader(prog.vert_id, prog.vert_path)};
+    ok = check_shader(prog.frag_id, prog.frag_path) && ok;
+
+    GLint result {GL_FALSE};
+    int info_log_length {0};
+    glGetProgramiv(prog.id, GL_LINK_STATUS, &result);
+    glGetProgramiv(prog.id, GL_INFO_LOG_LENGTH, &info_log_length);
+    if (info_log_length > 0) {
+        std::vector<char> msg(info_log_length + 1);
+        glGetProgramInfoLog(prog.id, info_log_length, nullptr, &msg[0]);
+        if (result == GL_FALSE) {
+            ERR("could not link shader program:\n", &msg[0]);
+        } else {
+            DBG_CAT(logs::Category::assets, 1,
+                    "shader program link log:\n", &msg[0]);
+        }
+    }
+    ok = ok && result != GL_FALSE;
+
+    glDetachShader(prog.id, prog.vert_id);
+    glDetachShader(prog.id, prog.frag_id);
+    glDeleteShader(prog.vert_id);
+    glDeleteShader(prog.frag_id);
+    prog.vert_id = 0;
+    prog.frag_id = 0;
+
+    if (!ok) {
+        ERR("shader program failed: ", prog.vert_path, " ",
+            prog.frag_path);
+        glDeleteProgram(prog.id);
+        prog.id = 0;
+        prog.state = Shader_program::State::failed;
+        return;
+    }
+
+    prog.uniform_locs.clear();
+    for (const auto& name : prog.uniform_names) {
+        prog.uniform_locs.push_back(
+            glGetUniformLocation(prog.id, name.c_str()));
+    }
+    prog.state = Shader_program::State::ready;
+}
+
+void Shader_manager::reload(Program_id id)
+{
+    // editors often write a file more than once, only the last one matters
+    for (std::size_t i {0}; i < reloads.size(); ++i) {
+        if (reloads[i].id == id) {
+            release(reloads[i].prog);
+            reloads[i] = std::move(reloads.back());
+            reloads.pop_back();
+            break;
+        }
+    }
+
+    Reload r {id, Shader_program{}};
+    r.prog.vert_path = programs[id].vert_path;
+    r.prog.frag_path = programs[id].frag_path;
+    r.prog.uniform_names = programs[id].uniform_names;
+    if (!issue(r.prog)) {
+        ERR("shader reload failed, keeping the old program");
+        release(r.prog);
+        return;
+    }
+    link(r.prog);
+    reloads.push_back(std::move(r));
+}
+
+void Shader_manager::release(Shader_program& prog)
+{
+    if (prog.vert_id != 0) { glDeleteShader(prog.vert_id); }
+    if (prog.frag_id != 0) { glDeleteShader(prog.frag_id); }
+    if (prog.id != 0) { glDeleteProgram(prog.id); }
+    prog.vert_id = 0;
+    prog.frag_id = 0;
+    prog.id = 0;
+}
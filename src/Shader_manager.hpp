@@ -0,0 +1,120 @@
+#ifndef SRC_SHADER_MANAGER_HPP_
+#define SRC_SHADER_MANAGER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "File_watcher.hpp"
+
+/*******************************************************************************
+ * Owns all shader programs of the game.
+ *
+ * Programs are queued with add() and then compiled and linked all at once by
+ * compile_all(), which only issues the work to the driver. Where
+ * GL_KHR_parallel_shader_compile (or the ARB variant) is available the driver
+ * compiles them on its own threads, so compilation overlaps across programs and
+ * with whatever start-up work comes after (e.g. texture loading). Compile and
+ * link status is only queried once a program is actually needed via get().
+ *
+ * With watch() set up, update() recompiles programs whose sources changed on
+ * disk using the same non-blocking path and swaps in the new program (and its
+ * uniform locations) only once it linked successfully. A failed reload is
+ * logged and the old program stays in use.
+ ******************************************************************************/
+
+struct Shader_program final {
+    enum class State {
+        queued,    // added, nothing sent to the driver yet
+        compiling, // compile and link issued, status not checked yet
+        ready,     // linked successfully, uniform locations cached
+        failed
+    };
+
+    std::string vert_path;
+    std::string frag_path;
+    std::vector<std::string> uniform_names;
+
+    State state {State::queued};
+    GLuint vert_id {0};
+    GLuint frag_id {0};
+    GLuint id {0}; // program object, valid once ready
+    std::vector<GLint> uniform_locs; // same order as uniform_names
+};
+
+class Shader_manager final {
+public:
+    using Program_id = std::size_t;
+
+    Shader_manager() = default;
+    ~Shader_manager();
+
+    Shader_manager(const Shader_manager&) = delete;
+    Shader_manager& operator=(const Shader_manager&) = delete;
+
+    /* queue a program, the uniforms listed will have their locations cached
+       and can later be fetched by index via uniform() */
+    Program_id add(
+        const std::string& vert_path,
+        const std::string& frag_path,
+        std::vector<std::string> uniform_names);
+
+    /* issue compiles and links for all queued programs without waiting for
+       the driver, requires a current GL context
+       returns false if a shader source could not be read */
+    bool compile_all();
+
+    /* returns the program, checking compile/link status on first use (will
+       block if the driver is not done yet)
+       returns 0 on error */
+    GLuint get(Program_id id);
+
+    /* true if the driver is done with the program, never blocks; lets a
+       loading screen keep drawing until get() would return right away */
+    bool is_ready(Program_id id) const;
+
+    // cached location of the uniform at 'idx' of the names given to add()
+    GLint uniform(Program_id id, std::size_t idx) const
+    {
+        return programs[id].uniform_locs[idx];
+    }
+
+    // reload programs when their sources in 'dir' change, false on error
+    bool watch(const std::string& dir);
+
+    /* picks up changed sources and swaps in finished reloads, call once per
+       frame outside of drawing so a frame never sees a half-swapped program */
+    void update();
+
+    /* deletes all programs, requires the GL context so has to come before it
+       is destroyed; the destructor does it otherwise */
+    void shutdown();
+
+private:
+    // a recompile of programs[id] in flight
+    struct Reload {
+        Program_id id;
+        Shader_program prog;
+    };
+
+    // issue the compile for one program, false if sources can't be read
+    bool issue(Shader_program& prog);
+    void link(Shader_program& prog);
+    // true if the driver is done with compile and link
+    bool done(const Shader_program& prog) const;
+    // check compile/link results, cache uniforms and release the shaders
+    void finish(Shader_program& prog);
+    // start recompiling programs[id], replaces a reload already in flight
+    void reload(Program_id id);
+    void release(Shader_program& prog);
+
+    std::vector<Shader_program> programs;
+    std::vector<Reload> reloads;
+    File_watcher watcher;
+    std::vector<std::string> changed_files; // kept to avoid reallocating
+    bool parallel_compile {false};
+};
+
+#endif // SRC_SHADER_MANAGER_HPP_
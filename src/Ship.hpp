@@ -3,22 +3,24 @@
 
 // TODO probably separate out a more general Particle3 and inherit from
 struct Bullet final {
+    Bullet() = default;
     Bullet(glm::vec3 pos, glm::vec3 vel);
 
     glm::vec3 pos;
     glm::vec3 vel;
 
-    // TODO ttl is not used at the moment (they live forever a.k.a. mem leak)
+    // TODO ttl is not used at the moment, bullets live until leaving the arena
     float ttl; // remaining time to live
 };
 
-Bullet::Bullet(glm::vec3 pos, glm::vec3 vel)
+inline Bullet::Bullet(glm::vec3 pos, glm::vec3 vel)
 : pos {pos}
 , vel {vel}
 , ttl {10.0f}
 {}
 
 struct Ship final: public Obj3 {
+    Ship() = default;
     Ship(
         Model3* model,
         glm::vec3 pos,
@@ -28,14 +30,14 @@ struct Ship final: public Obj3 {
     glm::vec3 color;
     glm::vec3 gun_disp; // where bullets come out from, displacement rel. front;
 
-    GLfloat accel; // acceleration
-    GLfloat rot_rate;
+    float accel; // acceleration
+    float rot_rate;
 
-    GLfloat shot_cooldown; // time between shots
-    GLfloat shot_cooldown_rem; // remaining cooldown time till next shot
+    float shot_cooldown; // time between shots
+    float shot_cooldown_rem; // remaining cooldown time till next shot
 };
 
-Ship::Ship(
+inline Ship::Ship(
     Model3* model,
     glm::vec3 pos,
     glm::vec3 rot,
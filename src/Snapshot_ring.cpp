@@ -0,0 +1,51 @@
+#include "Snapshot_ring.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+#include "sim.hpp"
+
+namespace {
+// marks a slot without a snapshot, no run gets that many steps
+constexpr std::uint64_t no_step {std::numeric_limits<std::uint64_t>::max()};
+} // namespace
+
+Snapshot_ring::Snapshot_ring(std::size_t capacity)
+: slots {std::max<std::size_t>(capacity, 1)}
+, worlds {std::make_unique<sim::World[]>(slots)}
+{
+    clear();
+}
+
+void Snapshot_ring::save(const sim::World& world)
+{
+    sim::save(world, worlds[world.steps % slots]);
+}
+
+const sim::World* Snapshot_ring::find(std::uint64_t step) const
+{
+    const sim::World& snapshot {worlds[step % slots]};
+    return snapshot.steps == step ? &snapshot : nullptr;
+}
+
+bool Snapshot_ring::restore(std::uint64_t step, sim::World& world)
+{
+    const sim::World* snapshot {find(step)};
+    if (snapshot == nullptr) { return false; }
+
+    sim::restore(world, *snapshot);
+    for (std::size_t i {0}; i < slots; ++i) {
+        if (worlds[i].steps != no_step && worlds[i].steps > step) {
+            worlds[i].steps = no_step;
+        }
+    }
+    return true;
+}
+
+void Snapshot_ring::clear()
+{
+    for (std::size_t i {0}; i < slots; ++i) { worlds[i].steps = no_step; }
+}
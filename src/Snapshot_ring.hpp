@@ -0,0 +1,47 @@
+#ifndef SRC_SNAPSHOT_RING_HPP_
+#define SRC_SNAPSHOT_RING_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "sim.hpp"
+
+/*******************************************************************************
+ * The last N states of a sim::World, for rolling back and resimulating.
+ *
+ * Snapshots are kept by step number (World::steps) in a ring allocated once,
+ * saving one is a single memcpy of the World. Rewinding is restore() of an
+ * older step followed by stepping again with the corrected input, a few
+ * frames of that fit in one frame's time. Snapshots after a restored step are
+ * dropped, they are of a future that is being rewritten.
+ ******************************************************************************/
+
+class Snapshot_ring final {
+public:
+    explicit Snapshot_ring(std::size_t capacity);
+
+    Snapshot_ring(const Snapshot_ring&) = delete;
+    Snapshot_ring& operator=(const Snapshot_ring&) = delete;
+
+    std::size_t capacity() const { return slots; }
+
+    // keeps the world's current state, replacing the oldest one when full
+    void save(const sim::World& world);
+
+    // the state at 'step', nullptr if it's not kept
+    const sim::World* find(std::uint64_t step) const;
+
+    /* puts the world back to 'step' and drops the later snapshots, false
+       (world untouched) if that step is not kept */
+    bool restore(std::uint64_t step, sim::World& world);
+
+    // drops all snapshots
+    void clear();
+
+private:
+    std::size_t slots;
+    std::unique_ptr<sim::World[]> worlds;
+};
+
+#endif // SRC_SNAPSHOT_RING_HPP_
@@ -0,0 +1,241 @@
+#include "alloc_tracker.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string_view>
+
+#include "logs.hpp"
+
+namespace {
+constexpr std::size_t max_zones {64};
+
+// trivially initialised, safe to use from operator new at any point
+thread_local alloc_tracker::Counts counts {};
+
+bool check_mode {false};
+
+struct Zone {
+    const char* name;
+    alloc_tracker::Counts total;
+    std::uint64_t frame_allocs; // since the last end_frame()
+};
+
+std::mutex zones_mutex;
+Zone zones[max_zones];
+std::size_t zone_count {0};
+
+// frame loop thread only
+alloc_tracker::Counts frame_start {};
+std::uint64_t frames {0};
+std::uint64_t frames_allocating {0}; // after warm-up
+std::uint64_t max_frame_allocs {0};
+std::uint64_t max_frame_bytes {0};
+
+void count_alloc(std::size_t size)
+{
+    if (!alloc_tracker::enabled.load(std::memory_order_relaxed)) { return; }
+    ++counts.allocs;
+    counts.bytes += size;
+}
+
+void count_free(void* p)
+{
+    if (p == nullptr ||
+        !alloc_tracker::enabled.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    ++counts.frees;
+}
+
+void* allocate(std::size_t size, std::size_t align)
+{
+    count_alloc(size);
+    if (size == 0) { size = 1; }
+
+    void* p {nullptr};
+    if (align <= alignof(std::max_align_t)) {
+        p = std::malloc(size);
+    } else if (posix_memalign(&p, align, size) != 0) {
+        p = nullptr;
+    }
+    return p;
+}
+
+alloc_tracker::Counts operator-(
+    const alloc_tracker::Counts& a,
+    const alloc_tracker::Counts& b)
+{
+    return alloc_tracker::Counts{
+        a.allocs - b.allocs, a.frees - b.frees, a.bytes - b.bytes};
+}
+} // namespace
+
+namespace alloc_tracker {
+    std::atomic<bool> enabled {false};
+
+    void init(int argc, char** argv)
+    {
+        const char* env {std::getenv("RNB_ALLOC")};
+        std::string_view mode {env != nullptr ? env : ""};
+        for (int i {1}; i < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            if (arg == "--alloc-track") {
+                mode = "track";
+            } else if (arg == "--alloc-check") {
+                mode = "check";
+            }
+        }
+        if (mode.empty()) { return; }
+        if (mode != "track" && mode != "check") {
+            ERR("bad RNB_ALLOC value (track|check): ", mode);
+            return;
+        }
+
+        check_mode = mode == "check";
+        enabled.store(true);
+        frame_start = counts;
+        INFO("tracking allocations",
+             check_mode ? ", none allowed after warm-up" : "");
+    }
+
+    Counts thread_counts() { return counts; }
+
+    void zone_done(const char* name, const Counts& start)
+    {
+        const Counts delta {counts - start};
+        if (delta.allocs == 0 && delta.frees == 0) { return; }
+
+        std::lock_guard<std::mutex> lock {zones_mutex};
+        std::size_t i {0};
+        while (i < zone_count && std::strcmp(zones[i].name, name) != 0) {
+            ++i;
+        }
+        if (i == zone_count) {
+            if (zone_count == max_zones) { return; }
+            zones[zone_count++] = Zone{name, Counts{}, 0};
+        }
+        zones[i].total.allocs += delta.allocs;
+        zones[i].total.frees += delta.frees;
+        zones[i].total.bytes += delta.bytes;
+        zones[i].frame_allocs += delta.allocs;
+    }
+
+    void end_frame()
+    {
+        if (!enabled.load(std::memory_order_relaxed)) { return; }
+
+        const Counts frame {counts - frame_start};
+        frame_start = counts;
+        ++frames;
+
+        if (frames > warmup_frames && frame.allocs > 0) {
+            ++frames_allocating;
+            if (check_mode) {
+                ERR("frame ", frames, " allocated ", frame.allocs,
+                    " times (", frame.bytes, " B) after warm-up");
+                std::lock_guard<std::mutex> lock {zones_mutex};
+                for (std::size_t i {0}; i < zone_count; ++i) {
+                    if (zones[i].frame_allocs > 0) {
+                        ERR("  in zone ", zones[i].name, ": ",
+                            zones[i].frame_allocs);
+                    }
+                }
+                logs::flush();
+                std::abort();
+            }
+        }
+        if (frames > warmup_frames) {
+            if (frame.allocs > max_frame_allocs) {
+                max_frame_allocs = frame.allocs;
+            }
+            if (frame.bytes > max_frame_bytes) {
+                max_frame_bytes = frame.bytes;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock {zones_mutex};
+        for (std::size_t i {0}; i < zone_count; ++i) {
+            zones[i].frame_allocs = 0;
+        }
+    }
+
+    void report()
+    {
+        if (!enabled.load()) { return; }
+
+        INFO("allocations on this thread: ", counts.allocs, " (",
+             counts.bytes, " B), frees: ", counts.frees);
+        INFO("frames: ", frames, ", allocating after warm-up: ",
+             frames_allocating, ", max per frame: ", max_frame_allocs,
+             " (", max_frame_bytes, " B)");
+        std::lock_guard<std::mutex> lock {zones_mutex};
+        for (std::size_t i {0}; i < zone_count; ++i) {
+            INFO("zone ", zones[i].name, ": ", zones[i].total.allocs,
+                 " allocs (", zones[i].total.bytes, " B), ",
+                 zones[i].total.frees, " frees");
+        }
+    }
+} // namespace alloc_tracker
+
+void* operator new(std::size_t size)
+{
+    void* p {allocate(size, alignof(std::max_align_t))};
+    if (p == nullptr) { throw std::bad_alloc{}; }
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    void* p {allocate(size, static_cast<std::size_t>(align))};
+    if (p == nullptr) { throw std::bad_alloc{}; }
+    return p;
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void* p) noexcept
+{
+    count_free(p);
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    operator delete(p);
+}
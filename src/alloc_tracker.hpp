@@ -0,0 +1,59 @@
+#ifndef SRC_ALLOC_TRACKER_HPP_
+#define SRC_ALLOC_TRACKER_HPP_
+
+/*******************************************************************************
+ * Heap allocation tracking.
+ *
+ * The global operator new/delete are replaced (alloc_tracker.cpp) with ones
+ * that count allocations per thread while tracking is on, which costs one
+ * relaxed atomic load per allocation while it's off. Turned on with
+ * "--alloc-track" or RNB_ALLOC=track.
+ *
+ * The counts are attributed to:
+ * - frames: end_frame() takes what the calling (main) thread allocated since
+ *   the last call
+ * - zones: every trace::Scope (see trace.hpp), counted inclusively, so an
+ *   allocation in a nested scope counts for all scopes around it too
+ *
+ * "--alloc-check" or RNB_ALLOC=check tracks and also treats any allocation in
+ * a frame after the warm-up frames as a bug: the frame and the zones that
+ * allocated are logged and the process aborts (leaving a flight recorder
+ * dump).
+ *
+ * Only operator new is seen, not malloc() calls from C libraries or drivers.
+ *
+ * librnb_batch.so links alloc_tracker_off.cpp instead, which leaves operator
+ * new alone.
+ ******************************************************************************/
+
+#include <atomic>
+#include <cstdint>
+
+namespace alloc_tracker {
+    struct Counts final {
+        std::uint64_t allocs;
+        std::uint64_t frees;
+        std::uint64_t bytes; // allocated, frees don't know their size
+    };
+
+    extern std::atomic<bool> enabled;
+
+    // frames after which check mode expects no more allocations
+    constexpr std::uint64_t warmup_frames {120};
+
+    void init(int argc, char** argv);
+
+    // what the calling thread allocated so far while tracking was on
+    Counts thread_counts();
+
+    // attributes what the calling thread allocated since 'start' to a zone
+    void zone_done(const char* name, const Counts& start);
+
+    // call once per frame, from the thread running the frame loop
+    void end_frame();
+
+    // logs totals, per frame figures and the zones that allocated
+    void report();
+} // namespace alloc_tracker
+
+#endif // SRC_ALLOC_TRACKER_HPP_
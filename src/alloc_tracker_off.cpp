@@ -0,0 +1,20 @@
+/* alloc_tracker for librnb_batch.so: a library must not replace its host's
+ * operator new, so this one replaces nothing and tracking is never on. */
+
+#include "alloc_tracker.hpp"
+
+#include <atomic>
+
+namespace alloc_tracker {
+    std::atomic<bool> enabled {false};
+
+    void init(int, char**) {}
+
+    Counts thread_counts() { return Counts{0, 0, 0}; }
+
+    void zone_done(const char*, const Counts&) {}
+
+    void end_frame() {}
+
+    void report() {}
+} // namespace alloc_tracker
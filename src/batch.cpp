@@ -0,0 +1,314 @@
+#include "batch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "logs.hpp"
+#include "scenario.hpp"
+#include "sim.hpp"
+#include "trace.hpp"
+
+namespace {
+/* the caller plus threads - 1 workers, each running its part of a job; the
+   caller waits for all parts, so a job may reference its stack */
+class Pool final {
+public:
+    explicit Pool(std::size_t threads);
+    ~Pool();
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    std::size_t size() const { return workers.size() + 1; }
+
+    // calls job(part) for every part in [0, size()), returns once all are done
+    template<typename Job>
+    void run(const Job& job);
+
+private:
+    void work(std::size_t part);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start;
+    std::condition_variable done;
+    void (*call)(const void* job, std::size_t part) {nullptr};
+    const void* job {nullptr};
+    std::uint64_t generation {0};
+    std::size_t running {0};
+    bool stop {false};
+};
+
+Pool::Pool(std::size_t threads)
+{
+    for (std::size_t i {1}; i < threads; ++i) {
+        workers.emplace_back(&Pool::work, this, i);
+    }
+}
+
+Pool::~Pool()
+{
+    {
+        std::lock_guard<std::mutex> lock {mutex};
+        stop = true;
+    }
+    start.notify_all();
+    for (std::thread& worker : workers) { worker.join(); }
+}
+
+template<typename Job>
+void Pool::run(const Job& job)
+{
+    auto caller {[](const void* j, std::size_t part) {
+        (*static_cast<const Job*>(j))(part);
+    }};
+    {
+        std::lock_guard<std::mutex> lock {mutex};
+        call = caller;
+        this->job = &job;
+        running = workers.size();
+        ++generation;
+    }
+    start.notify_all();
+    job(0);
+
+    std::unique_lock<std::mutex> lock {mutex};
+    done.wait(lock, [this] { return running == 0; });
+}
+
+void Pool::work(std::size_t part)
+{
+    trace::set_thread_name("batch worker");
+    std::uint64_t seen {0};
+    for (;;) {
+        std::unique_lock<std::mutex> lock {mutex};
+        start.wait(lock, [this, seen] { return stop || generation != seen; });
+        if (stop) { return; }
+        seen = generation;
+        const auto c {call};
+        const void* const j {job};
+        lock.unlock();
+
+        c(j, part);
+
+        lock.lock();
+        if (--running == 0) { done.notify_one(); }
+    }
+}
+
+// the shorter way from 'from' to 'to' on an axis of length 'size' that wraps
+float wrapped(float from, float to, float size)
+{
+    float d {to - from};
+    if (d > size / 2) { d -= size; }
+    if (d < -size / 2) { d += size; }
+    return d;
+}
+
+void observe_world(const sim::World& world, float* out)
+{
+    for (std::size_t p {0}; p < world.players; ++p) {
+        const Ship& ship {world.ships[p]};
+        const float heading {glm::radians(ship.rot.z)};
+        *out++ = ship.pos.x;
+        *out++ = ship.pos.y;
+        *out++ = ship.vel.x;
+        *out++ = ship.vel.y;
+        *out++ = std::sin(heading);
+        *out++ = std::cos(heading);
+        *out++ = std::max(ship.shot_cooldown_rem, 0.0f);
+    }
+
+    // the nearest few by insertion, there are at most a thousand
+    struct Near final {
+        float dist2;
+        float dx;
+        float dy;
+        std::uint32_t rock;
+    };
+    Near nearest[RNB_OBS_ROCKS];
+    std::size_t found {0};
+    const glm::vec3 from {world.players > 0 ?
+        world.ships[0].pos : glm::vec3{0.0f}};
+    for (std::uint32_t i {0}; i < world.rocks.size(); ++i) {
+        const Rock& rock {world.rocks[i]};
+        const float dx {wrapped(from.x, rock.pos.x, world.arena.w)};
+        const float dy {wrapped(from.y, rock.pos.y, world.arena.h)};
+        const float dist2 {dx * dx + dy * dy};
+        if (found == RNB_OBS_ROCKS && dist2 >= nearest[found - 1].dist2) {
+            continue;
+        }
+        std::size_t at {found < RNB_OBS_ROCKS ? found++ : found - 1};
+        for (; at > 0 && nearest[at - 1].dist2 > dist2; --at) {
+            nearest[at] = nearest[at - 1];
+        }
+        nearest[at] = Near{dist2, dx, dy, i};
+    }
+    for (std::size_t i {0}; i < RNB_OBS_ROCKS; ++i) {
+        if (i >= found) {
+            std::fill_n(out, RNB_OBS_ROCK, 0.0f);
+            out += RNB_OBS_ROCK;
+            continue;
+        }
+        const Rock& rock {world.rocks[nearest[i].rock]};
+        *out++ = nearest[i].dx;
+        *out++ = nearest[i].dy;
+        *out++ = rock.vel.x;
+        *out++ = rock.vel.y;
+        *out++ = rock.radius;
+    }
+
+    *out = static_cast<float>(world.rock_hits);
+}
+} // namespace
+
+struct rnb_batch {
+    std::size_t worlds;
+    std::size_t players;
+    scenario::Config scenario;
+    float dt;
+    std::unique_ptr<sim::World[]> world;
+    Pool pool;
+
+    rnb_batch(const rnb_batch_config& config, std::size_t threads)
+    : worlds {config.worlds}
+    , players {config.players}
+    , dt {config.dt > 0.0f ? config.dt : 1.0f / 60}
+    , world {new sim::World[config.worlds]}
+    , pool {threads}
+    {
+        scenario.ai_ships = config.ai_ships;
+        scenario.rocks = config.rocks;
+        scenario.fire_rate = config.fire_rate;
+    }
+
+    // the worlds of a pool thread
+    std::size_t first(std::size_t part) const
+    {
+        return worlds * part / pool.size();
+    }
+
+    void reset(std::size_t i, std::uint64_t seed)
+    {
+        sim::World& w {world[i]};
+        w.ships.clear();
+        w.ai.clear();
+        w.rocks.clear();
+        w.bullets.clear();
+        w.steps = 0;
+        w.rock_hits = 0;
+        w.arena = scenario::default_arena();
+        scenario::add_players(w, players, nullptr);
+        scenario::Config config {scenario};
+        config.seed = seed;
+        scenario::spawn(config, w, nullptr, nullptr);
+    }
+};
+
+extern "C" {
+rnb_batch* rnb_batch_create(const rnb_batch_config* config)
+{
+    if (config == nullptr || config->worlds == 0 || config->players == 0 ||
+        config->players > RNB_MAX_PLAYERS ||
+        config->players + config->ai_ships > sim::max_ships ||
+        config->rocks > sim::max_rocks || config->fire_rate < 0.0f ||
+        config->dt < 0.0f)
+    {
+        ERR("batch: config out of range");
+        return nullptr;
+    }
+
+    const std::size_t threads {config->threads != 0 ? config->threads :
+        std::max(1u, std::thread::hardware_concurrency())};
+    rnb_batch* batch {nullptr};
+    // nothing may be thrown across the C API
+    try {
+        batch = new rnb_batch(
+            *config, std::min<std::size_t>(threads, config->worlds));
+    } catch (const std::exception& e) {
+        ERR("batch: can not create ", config->worlds, " worlds: ",
+            e.what());
+        return nullptr;
+    }
+    rnb_batch_reset_all(batch, 1);
+    // so stepping never allocates on any pool thread
+    batch->pool.run([](std::size_t) {
+        sim::reserve_scratch(scenario::default_arena());
+    });
+    INFO("batch: ", batch->worlds, " worlds of ", batch->players,
+         " players, ", config->ai_ships, " AI ships and ",
+         config->rocks, " rocks on ", batch->pool.size(), " threads");
+    return batch;
+}
+
+void rnb_batch_destroy(rnb_batch* batch)
+{
+    delete batch;
+}
+
+void rnb_batch_reset(rnb_batch* batch, size_t world, uint64_t seed)
+{
+    if (world < batch->worlds) { batch->reset(world, seed); }
+}
+
+void rnb_batch_reset_all(rnb_batch* batch, uint64_t seed)
+{
+    batch->pool.run([batch, seed](std::size_t part) {
+        for (std::size_t i {batch->first(part)}; i < batch->first(part + 1);
+             ++i)
+        {
+            batch->reset(i, seed + i);
+        }
+    });
+}
+
+void rnb_batch_step(rnb_batch* batch, const uint8_t* inputs, uint32_t steps)
+{
+    TRACE_SCOPE("batch step");
+    batch->pool.run([batch, inputs, steps](std::size_t part) {
+        const std::size_t players {batch->players};
+        const float dt {batch->dt};
+        for (std::size_t i {batch->first(part)}; i < batch->first(part + 1);
+             ++i)
+        {
+            sim::World& world {batch->world[i]};
+            for (std::uint32_t s {0}; s < steps; ++s) {
+                if (inputs != nullptr) {
+                    for (std::size_t p {0}; p < players; ++p) {
+                        sim::apply_input(
+                            world, p, inputs[i * players + p], dt);
+                    }
+                }
+                sim::step(world, dt);
+            }
+        }
+    });
+}
+
+size_t rnb_batch_observation_size(const rnb_batch* batch)
+{
+    return batch->players * RNB_OBS_SHIP + RNB_OBS_ROCKS * RNB_OBS_ROCK + 1;
+}
+
+void rnb_batch_observe(rnb_batch* batch, float* out)
+{
+    const std::size_t size {rnb_batch_observation_size(batch)};
+    batch->pool.run([batch, out, size](std::size_t part) {
+        for (std::size_t i {batch->first(part)}; i < batch->first(part + 1);
+             ++i)
+        {
+            observe_world(batch->world[i], out + i * size);
+        }
+    });
+}
+} // extern "C"
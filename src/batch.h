@@ -0,0 +1,89 @@
+#ifndef SRC_BATCH_H_
+#define SRC_BATCH_H_
+
+/* Many independent headless matches in one process, stepped together on all
+ * cores, for training and balancing AI where throughput is what counts. A C
+ * API so anything with a C FFI can drive it, "make batch" builds
+ * librnb_batch.so and dev/tools/batchrun uses it.
+ *
+ * Every world is a match like the game's scenarios (scenario.hpp): 'players'
+ * ships steered by the caller plus AI ships and rocks. rnb_batch_step() takes
+ * an input byte per player of every world and steps all worlds, each thread of
+ * the batch's pool taking its own contiguous range of worlds. Inputs and
+ * observations are arrays the caller owns, world after world, nothing is
+ * allocated after rnb_batch_create().
+ *
+ * A world's match depends only on its seed and inputs, not on the number of
+ * threads. A batch is not thread-safe, it has to be driven from one thread. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* the library is built with hidden visibility, only these are exported */
+#if defined(__GNUC__)
+#define RNB_API __attribute__((visibility("default")))
+#else
+#define RNB_API
+#endif
+
+/* input bits, as sim::Input_bits */
+#define RNB_INPUT_THRUST 1
+#define RNB_INPUT_LEFT 2
+#define RNB_INPUT_RIGHT 4
+#define RNB_INPUT_FIRE 8
+
+#define RNB_MAX_PLAYERS 8
+
+/* An observation is floats, for each world:
+ *   RNB_OBS_SHIP per player ship: x, y, velocity x, y (per step), sine and
+ *     cosine of the heading, seconds until it can fire again
+ *   RNB_OBS_ROCKS rocks nearest to the first player, RNB_OBS_ROCK each:
+ *     offset x, y from that ship the short way around the arena, velocity x,
+ *     y, radius; all zero when there are fewer rocks
+ *   rocks hit in the world so far
+ * Positions are in arena units, the arena is about 82 by 46 around 0, 0. */
+#define RNB_OBS_SHIP 7
+#define RNB_OBS_ROCKS 8
+#define RNB_OBS_ROCK 5
+
+typedef struct rnb_batch rnb_batch;
+
+typedef struct rnb_batch_config {
+    uint32_t worlds;
+    uint32_t players; /* steered by the caller, 1 to RNB_MAX_PLAYERS */
+    uint32_t ai_ships;
+    uint32_t rocks;
+    float fire_rate; /* shots per second of each AI ship, 0 for none */
+    float dt; /* seconds per step, 0 for 1/60 */
+    uint32_t threads; /* 0 for one per core */
+} rnb_batch_config;
+
+/* Allocates the worlds and starts the threads, the worlds are reset with seed
+ * 1. NULL if the config is out of range (logged) or memory runs out. */
+RNB_API rnb_batch* rnb_batch_create(const rnb_batch_config* config);
+RNB_API void rnb_batch_destroy(rnb_batch* batch);
+
+/* Puts world 'world' back to the start of a match with 'seed'. */
+RNB_API void rnb_batch_reset(rnb_batch* batch, size_t world, uint64_t seed);
+/* All of them, world i with seed + i, in parallel. */
+RNB_API void rnb_batch_reset_all(rnb_batch* batch, uint64_t seed);
+
+/* Steps every world 'steps' times with the same input. 'inputs' holds a byte
+ * per player for each world, world after world, NULL for no input. */
+RNB_API void rnb_batch_step(
+    rnb_batch* batch, const uint8_t* inputs, uint32_t steps);
+
+/* Floats per world in an observation. */
+RNB_API size_t rnb_batch_observation_size(const rnb_batch* batch);
+/* Writes worlds * rnb_batch_observation_size() floats to 'out'. */
+RNB_API void rnb_batch_observe(rnb_batch* batch, float* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SRC_BATCH_H_
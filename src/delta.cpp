@@ -0,0 +1,558 @@
+#include "delta.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "logs.hpp"
+#include "sim.hpp"
+
+namespace {
+constexpr unsigned pos_bits {20};
+constexpr float pos_scale {1 << pos_bits};
+constexpr std::uint32_t pos_mask {(1u << pos_bits) - 1};
+constexpr long max_vel {(1 << (pos_bits - 1)) - 1};
+
+struct Field final {
+    std::uint8_t bits;
+    bool raw; // float bits, only ever the same or replaced
+};
+
+// positions and velocities first in every kind of entity, they're predicted
+constexpr Field ship_layout[delta::ship_fields] {
+    {pos_bits, false}, {pos_bits, false}, // pos
+    {pos_bits, false}, {pos_bits, false}, // vel
+    {16, false}, // rot.z
+    {32, true}, {32, true}, // shot cooldown remaining, shot cooldown
+    {32, true}, {32, true}, // accel, rot_rate
+    {32, true}, {32, true}, // gun_disp x, y
+    {8, false}, {8, false}, {8, false}}; // color
+constexpr Field ai_layout[delta::ai_fields] {
+    {16, false}, {32, true}}; // target, retarget_in
+constexpr Field rock_layout[delta::rock_fields] {
+    {pos_bits, false}, {pos_bits, false},
+    {pos_bits, false}, {pos_bits, false},
+    {16, false}, // rot.z
+    {12, false}, // radius
+    {12, false}}; // spin
+constexpr Field bullet_layout[delta::bullet_fields] {
+    {pos_bits, false}, {pos_bits, false},
+    {pos_bits, false}, {pos_bits, false},
+    {32, true}}; // ttl
+
+// the baseline of entities the baseline frame doesn't have
+constexpr std::uint32_t no_entity[delta::ship_fields] {};
+
+constexpr std::uint32_t mask_of(unsigned bits)
+{
+    return bits == 32 ? ~0u : (1u << bits) - 1;
+}
+
+class Bit_writer final {
+public:
+    explicit Bit_writer(std::vector<std::uint8_t>& out): out {out} {}
+
+    // the low 'bits' bits of 'value', up to 32
+    void put(std::uint32_t value, unsigned bits)
+    {
+        acc |= static_cast<std::uint64_t>(value & mask_of(bits)) << count;
+        count += bits;
+        for (; count >= 8; count -= 8) {
+            out.push_back(static_cast<std::uint8_t>(acc));
+            acc >>= 8;
+        }
+    }
+
+    void put64(std::uint64_t value)
+    {
+        put(static_cast<std::uint32_t>(value), 32);
+        put(static_cast<std::uint32_t>(value >> 32), 32);
+    }
+
+    void flush()
+    {
+        if (count > 0) { out.push_back(static_cast<std::uint8_t>(acc)); }
+        acc = 0;
+        count = 0;
+    }
+
+private:
+    std::vector<std::uint8_t>& out;
+    std::uint64_t acc {0};
+    unsigned count {0};
+};
+
+class Bit_reader final {
+public:
+    Bit_reader(const std::uint8_t* data, std::size_t size)
+    : data {data}
+    , size {size}
+    {}
+
+    // 0 once past the end, check ok()
+    std::uint32_t get(unsigned bits)
+    {
+        while (count < bits) {
+            if (pos == size) {
+                good = false;
+                return 0;
+            }
+            acc |= static_cast<std::uint64_t>(data[pos++]) << count;
+            count += 8;
+        }
+        const auto value {static_cast<std::uint32_t>(acc & mask_of(bits))};
+        acc >>= bits;
+        count -= bits;
+        return value;
+    }
+
+    std::uint64_t get64()
+    {
+        const std::uint64_t low {get(32)};
+        return low | static_cast<std::uint64_t>(get(32)) << 32;
+    }
+
+    bool ok() const { return good; }
+
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+    std::size_t pos {0};
+    std::uint64_t acc {0};
+    unsigned count {0};
+    bool good {true};
+};
+
+/* '0' for the predicted value, else '1' and for quantized values the zigzag
+   encoded difference in 6 bits ('0') or 12 bits ('10'), or the value ('11') */
+void put_value(
+    Bit_writer& out,
+    std::uint32_t value,
+    std::uint32_t predicted,
+    const Field& field)
+{
+    if (value == predicted) {
+        out.put(0, 1);
+        return;
+    }
+    out.put(1, 1);
+    if (field.raw) {
+        out.put(value, 32);
+        return;
+    }
+
+    const std::uint32_t mask {mask_of(field.bits)};
+    const std::uint32_t diff {(value - predicted) & mask};
+    const std::int64_t signed_diff {diff > mask / 2 ?
+        static_cast<std::int64_t>(diff) - mask - 1 : diff};
+    const auto zigzag {static_cast<std::uint64_t>(
+        signed_diff < 0 ? -2 * signed_diff - 1 : 2 * signed_diff)};
+    if (zigzag < 64) {
+        out.put(0, 1);
+        out.put(static_cast<std::uint32_t>(zigzag), 6);
+    } else if (zigzag < 4096) {
+        out.put(1, 2);
+        out.put(static_cast<std::uint32_t>(zigzag), 12);
+    } else {
+        out.put(3, 2);
+        out.put(value, field.bits);
+    }
+}
+
+std::uint32_t get_value(
+    Bit_reader& in,
+    std::uint32_t predicted,
+    const Field& field)
+{
+    if (in.get(1) == 0) { return predicted; }
+    if (field.raw) { return in.get(32); }
+
+    std::uint32_t zigzag;
+    if (in.get(1) == 0) {
+        zigzag = in.get(6);
+    } else if (in.get(1) == 0) {
+        zigzag = in.get(12);
+    } else {
+        return in.get(field.bits);
+    }
+    const std::int64_t signed_diff {(zigzag & 1) != 0 ?
+        -static_cast<std::int64_t>((zigzag + 1) / 2) : zigzag / 2};
+    return static_cast<std::uint32_t>(predicted + signed_diff) &
+        mask_of(field.bits);
+}
+
+// positions move by their velocity over the steps since the baseline
+std::uint32_t predict(
+    const std::uint32_t* base,
+    std::size_t field,
+    std::uint64_t steps)
+{
+    if (field >= 2) { return base[field]; }
+    return static_cast<std::uint32_t>(
+        base[field] + base[field + 2] * steps) & pos_mask;
+}
+
+template<std::size_t Fields>
+void put_entities(
+    Bit_writer& out,
+    const std::vector<std::uint32_t>& entities,
+    const std::vector<std::uint32_t>& baseline,
+    const Field (&layout)[Fields],
+    std::uint64_t steps)
+{
+    const std::size_t count {entities.size() / Fields};
+    const std::size_t base_count {baseline.size() / Fields};
+    out.put(static_cast<std::uint32_t>(count), 16);
+    for (std::size_t i {0}; i < count; ++i) {
+        const std::uint32_t* base {
+            i < base_count ? &baseline[i * Fields] : no_entity};
+        for (std::size_t f {0}; f < Fields; ++f) {
+            put_value(out, entities[i * Fields + f], predict(base, f, steps),
+                      layout[f]);
+        }
+    }
+}
+
+template<std::size_t Fields>
+void get_entities(
+    Bit_reader& in,
+    std::vector<std::uint32_t>& entities,
+    const std::vector<std::uint32_t>& baseline,
+    const Field (&layout)[Fields],
+    std::uint64_t steps)
+{
+    const std::size_t count {in.get(16)};
+    const std::size_t base_count {baseline.size() / Fields};
+    entities.resize(count * Fields);
+    for (std::size_t i {0}; i < count && in.ok(); ++i) {
+        const std::uint32_t* base {
+            i < base_count ? &baseline[i * Fields] : no_entity};
+        for (std::size_t f {0}; f < Fields; ++f) {
+            entities[i * Fields + f] =
+                get_value(in, predict(base, f, steps), layout[f]);
+        }
+    }
+}
+
+std::uint32_t float_bits(float v)
+{
+    std::uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+float bits_float(std::uint32_t bits)
+{
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+std::int32_t sign_extend(std::uint32_t v, unsigned bits)
+{
+    const std::uint32_t sign {1u << (bits - 1)};
+    return static_cast<std::int32_t>((v ^ sign) - sign);
+}
+
+std::uint32_t quantize_pos(float v, float origin, float size)
+{
+    return static_cast<std::uint32_t>(
+        std::lround((v - origin) / size * pos_scale)) & pos_mask;
+}
+
+float pos_of(std::uint32_t q, float origin, float size)
+{
+    return origin + q * (size / pos_scale);
+}
+
+// in position units per step
+std::uint32_t quantize_vel(float v, float size)
+{
+    const long q {std::clamp(std::lround(v / size * pos_scale),
+                             -max_vel, max_vel)};
+    return static_cast<std::uint32_t>(q) & pos_mask;
+}
+
+float vel_of(std::uint32_t q, float size)
+{
+    return sign_extend(q, pos_bits) * (size / pos_scale);
+}
+
+// a turn in 16 bits, back in [-180, 180)
+std::uint32_t quantize_rot(float deg)
+{
+    return static_cast<std::uint32_t>(
+        std::lround(deg / 360.0f * 65536.0f)) & 0xffff;
+}
+
+float rot_of(std::uint32_t q)
+{
+    return sign_extend(q, 16) * (360.0f / 65536.0f);
+}
+
+std::uint32_t quantize_unit(float v)
+{
+    return static_cast<std::uint32_t>(
+        std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+}
+
+void put_motion(
+    std::vector<std::uint32_t>& out,
+    const Obj3& obj,
+    const Boxf& arena)
+{
+    out.push_back(quantize_pos(obj.pos.x, arena.x, arena.w));
+    out.push_back(quantize_pos(obj.pos.y, arena.y, arena.h));
+    out.push_back(quantize_vel(obj.vel.x, arena.w));
+    out.push_back(quantize_vel(obj.vel.y, arena.h));
+    out.push_back(quantize_rot(obj.rot.z));
+}
+
+void get_motion(const std::uint32_t* v, Obj3& obj, const Boxf& arena)
+{
+    obj.pos = glm::vec3{
+        pos_of(v[0], arena.x, arena.w), pos_of(v[1], arena.y, arena.h), 0.0f};
+    obj.vel = glm::vec3{vel_of(v[2], arena.w), vel_of(v[3], arena.h), 0.0f};
+    obj.rot = glm::vec3{0.0f, 0.0f, rot_of(v[4])};
+}
+} // namespace
+
+namespace delta {
+    bool Frame::operator==(const Frame& other) const
+    {
+        return steps == other.steps && rng == other.rng &&
+            rock_hits == other.rock_hits && players == other.players &&
+            ships == other.ships && ai == other.ai && rocks == other.rocks &&
+            bullets == other.bullets;
+    }
+
+    void capture(const sim::World& world, Frame& frame)
+    {
+        const Boxf& arena {world.arena};
+        frame.steps = world.steps;
+        frame.rng = world.rng.raw_state();
+        frame.rock_hits = world.rock_hits;
+        frame.players = static_cast<std::uint32_t>(world.players);
+
+        frame.ships.clear();
+        for (const Ship& ship : world.ships) {
+            put_motion(frame.ships, ship, arena);
+            frame.ships.push_back(float_bits(ship.shot_cooldown_rem));
+            frame.ships.push_back(float_bits(ship.shot_cooldown));
+            frame.ships.push_back(float_bits(ship.accel));
+            frame.ships.push_back(float_bits(ship.rot_rate));
+            frame.ships.push_back(float_bits(ship.gun_disp.x));
+            frame.ships.push_back(float_bits(ship.gun_disp.y));
+            frame.ships.push_back(quantize_unit(ship.color.x));
+            frame.ships.push_back(quantize_unit(ship.color.y));
+            frame.ships.push_back(quantize_unit(ship.color.z));
+        }
+
+        frame.ai.clear();
+        for (const sim::Ai_state& ai : world.ai) {
+            frame.ai.push_back(ai.target & 0xffff);
+            frame.ai.push_back(float_bits(ai.retarget_in));
+        }
+
+        frame.rocks.clear();
+        for (const Rock& rock : world.rocks) {
+            put_motion(frame.rocks, rock, arena);
+            frame.rocks.push_back(static_cast<std::uint32_t>(
+                std::clamp(std::lround(rock.radius * 1024.0f), 0L, 4095L)));
+            frame.rocks.push_back(static_cast<std::uint32_t>(
+                std::lround(rock.spin / 360.0f * 4096.0f)) & 0xfff);
+        }
+
+        frame.bullets.clear();
+        for (const Bullet& bullet : world.bullets) {
+            frame.bullets.push_back(
+                quantize_pos(bullet.pos.x, arena.x, arena.w));
+            frame.bullets.push_back(
+                quantize_pos(bullet.pos.y, arena.y, arena.h));
+            frame.bullets.push_back(quantize_vel(bullet.vel.x, arena.w));
+            frame.bullets.push_back(quantize_vel(bullet.vel.y, arena.h));
+            frame.bullets.push_back(float_bits(bullet.ttl));
+        }
+    }
+
+    void apply(
+        const Frame& frame,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model)
+    {
+        const Boxf& arena {world.arena};
+        world.steps = frame.steps;
+        world.rng.set_raw_state(frame.rng);
+        world.rock_hits = frame.rock_hits;
+        world.players = frame.players;
+
+        world.ships.clear();
+        for (std::size_t i {0}; i < frame.ships.size(); i += ship_fields) {
+            const std::uint32_t* v {&frame.ships[i]};
+            Ship ship {};
+            ship.model = ship_model;
+            get_motion(v, ship, arena);
+            // as update_ships() has it
+            ship.front = glm::vec3{
+                -std::sin(glm::radians(ship.rot.z)),
+                std::cos(glm::radians(ship.rot.z)),
+                0.0f};
+            ship.shot_cooldown_rem = bits_float(v[5]);
+            ship.shot_cooldown = bits_float(v[6]);
+            ship.accel = bits_float(v[7]);
+            ship.rot_rate = bits_float(v[8]);
+            ship.gun_disp = glm::vec3{bits_float(v[9]), bits_float(v[10]), 0};
+            ship.color = glm::vec3{
+                v[11] / 255.0f, v[12] / 255.0f, v[13] / 255.0f};
+            world.ships.push_back(ship);
+        }
+
+        world.ai.clear();
+        for (std::size_t i {0}; i < frame.ai.size(); i += ai_fields) {
+            world.ai.push_back(sim::Ai_state{
+                frame.ai[i], bits_float(frame.ai[i + 1])});
+        }
+
+        world.rocks.clear();
+        for (std::size_t i {0}; i < frame.rocks.size(); i += rock_fields) {
+            const std::uint32_t* v {&frame.rocks[i]};
+            Rock rock {};
+            rock.model = rock_model;
+            get_motion(v, rock, arena);
+            rock.front = glm::vec3{0.0f, 1.0f, 0.0f};
+            rock.radius = v[5] / 1024.0f;
+            rock.spin = sign_extend(v[6], 12) * (360.0f / 4096.0f);
+            world.rocks.push_back(rock);
+        }
+
+        world.bullets.clear();
+        for (std::size_t i {0}; i < frame.bullets.size();
+             i += bullet_fields)
+        {
+            const std::uint32_t* v {&frame.bullets[i]};
+            Bullet bullet {};
+            bullet.pos = glm::vec3{
+                pos_of(v[0], arena.x, arena.w),
+                pos_of(v[1], arena.y, arena.h),
+                0.0f};
+            bullet.vel = glm::vec3{
+                vel_of(v[2], arena.w), vel_of(v[3], arena.h), 0.0f};
+            bullet.ttl = bits_float(v[4]);
+            world.bullets.push_back(bullet);
+        }
+    }
+
+    std::size_t encode(
+        const Frame& frame,
+        const Frame& baseline,
+        std::vector<std::uint8_t>& out)
+    {
+        const std::size_t start {out.size()};
+        const std::uint64_t steps {frame.steps - baseline.steps};
+        Bit_writer bits {out};
+        bits.put64(baseline.steps);
+        bits.put(static_cast<std::uint32_t>(steps), 32);
+        bits.put64(frame.rng);
+        bits.put(static_cast<std::uint32_t>(
+            frame.rock_hits - baseline.rock_hits), 32);
+        bits.put(frame.players, 8);
+        put_entities(bits, frame.ships, baseline.ships, ship_layout, steps);
+        put_entities(bits, frame.ai, baseline.ai, ai_layout, steps);
+        put_entities(bits, frame.rocks, baseline.rocks, rock_layout, steps);
+        put_entities(
+            bits, frame.bullets, baseline.bullets, bullet_layout, steps);
+        bits.flush();
+
+        return out.size() - start;
+    }
+
+    bool decode(
+        const std::uint8_t* data,
+        std::size_t size,
+        const Frame& baseline,
+        Frame& out)
+    {
+        Bit_reader bits {data, size};
+        if (bits.get64() != baseline.steps) { return false; }
+        const std::uint64_t steps {bits.get(32)};
+        out.steps = baseline.steps + steps;
+        out.rng = bits.get64();
+        out.rock_hits = baseline.rock_hits + bits.get(32);
+        out.players = bits.get(8);
+        get_entities(bits, out.ships, baseline.ships, ship_layout, steps);
+        get_entities(bits, out.ai, baseline.ai, ai_layout, steps);
+        get_entities(bits, out.rocks, baseline.rocks, rock_layout, steps);
+        get_entities(
+            bits, out.bullets, baseline.bullets, bullet_layout, steps);
+
+        return bits.ok();
+    }
+
+    void Probe::init(int argc, char** argv)
+    {
+        for (int i {1}; i < argc; ++i) {
+            if (std::string_view{argv[i]} == "--delta-stats") {
+                enabled = true;
+            }
+        }
+        if (!enabled) { return; }
+        frames.resize(ack_lag + 1);
+        applied = std::make_unique<sim::World>();
+    }
+
+    void Probe::after_step(const sim::World& world)
+    {
+        if (!enabled) { return; }
+
+        Frame& frame {frames[world.steps % frames.size()]};
+        capture(world, frame);
+        static const Frame none {};
+        const Frame& old {frames[(world.steps + 1) % frames.size()]};
+        const Frame& baseline {
+            world.steps >= ack_lag && old.steps == world.steps - ack_lag ?
+                old : none};
+
+        buffer.clear();
+        const std::size_t size {encode(frame, baseline, buffer)};
+        bool ok {decode(buffer.data(), size, baseline, decoded) &&
+                 decoded == frame};
+        if (ok) {
+            applied->arena = world.arena;
+            apply(decoded, *applied, nullptr, nullptr);
+            capture(*applied, requantized);
+            ok = requantized == frame;
+        }
+        if (!ok && failures++ == 0) {
+            ERR("delta: snapshot of step ", world.steps,
+                " did not survive the round trip");
+        }
+
+        buffer.clear();
+        full_bytes += encode(frame, none, buffer);
+        bytes += size;
+        max_bytes = std::max(max_bytes, size);
+        ++snapshots;
+    }
+
+    void Probe::report() const
+    {
+        if (!enabled || snapshots == 0) { return; }
+        INFO("delta: ", snapshots, " snapshots, ", bytes / snapshots,
+             " bytes on average against the state ", ack_lag,
+             " steps before (at most ", max_bytes, "), ",
+             full_bytes / snapshots, " without, a World is ",
+             sizeof(sim::World), " bytes");
+        if (failures != 0) {
+            ERR("delta: ", failures,
+                " snapshots did not survive the round trip");
+        }
+    }
+} // namespace delta
@@ -0,0 +1,108 @@
+#ifndef SRC_DELTA_HPP_
+#define SRC_DELTA_HPP_
+
+/*******************************************************************************
+ * Compact world snapshots: quantized, delta encoded and bit packed.
+ *
+ * capture() turns a World into a Frame of small integers. Positions become
+ * fixed point relative to the arena (20 bits per axis, wrapping like the arena
+ * does), velocities use the same units per step, rotations 16 bits of a turn.
+ * Values with no natural range (cooldowns, timers) are kept as float bits.
+ *
+ * encode() writes a Frame as the difference to a baseline Frame the receiver
+ * already has (the last one it acknowledged, or an empty Frame for a full
+ * snapshot). Positions are predicted from the baseline's position and
+ * velocity, so anything moving in a straight line costs a bit per value;
+ * other changes cost 8 or 15 bits, or 3 plus the value's width when the
+ * difference is larger (33 for float bits). decode() needs the same baseline
+ * and gives back the exact Frame, apply() turns that into a World again.
+ * That World is only as precise as the quantization, good to look at but not
+ * to simulate on in lockstep with the original.
+ *
+ * --delta-stats encodes every step against the one ack_lag steps before it,
+ * checks the round trip and logs the sizes at exit.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "sim.hpp"
+
+namespace delta {
+    // quantized values per entity, in the order of the field tables
+    constexpr std::size_t ship_fields {14};
+    constexpr std::size_t ai_fields {2};
+    constexpr std::size_t rock_fields {7};
+    constexpr std::size_t bullet_fields {5};
+
+    struct Frame final {
+        std::uint64_t steps {0};
+        std::uint64_t rng {0};
+        std::uint64_t rock_hits {0};
+        std::uint32_t players {0};
+        std::vector<std::uint32_t> ships; // ship_fields each
+        std::vector<std::uint32_t> ai;
+        std::vector<std::uint32_t> rocks;
+        std::vector<std::uint32_t> bullets;
+
+        bool operator==(const Frame& other) const;
+    };
+
+    // quantizes relative to world.arena, reuses the frame's memory
+    void capture(const sim::World& world, Frame& frame);
+
+    /* the world 'frame' describes, in 'world' whose arena has to be the one
+       it was captured in */
+    void apply(
+        const Frame& frame,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model);
+
+    // appends 'frame' relative to 'baseline' to 'out', returns its size
+    std::size_t encode(
+        const Frame& frame,
+        const Frame& baseline,
+        std::vector<std::uint8_t>& out);
+
+    /* reads a frame encoded against 'baseline', false if the data is cut
+       short or was encoded against another baseline */
+    bool decode(
+        const std::uint8_t* data,
+        std::size_t size,
+        const Frame& baseline,
+        Frame& out);
+
+    // steps between a snapshot and its baseline for --delta-stats
+    constexpr std::size_t ack_lag {6};
+
+    class Probe final {
+    public:
+        // enabled with --delta-stats
+        void init(int argc, char** argv);
+
+        // encodes, decodes and checks the step's state, call after a step
+        void after_step(const sim::World& world);
+
+        bool failed() const { return failures != 0; }
+
+        void report() const;
+
+    private:
+        bool enabled {false};
+        std::vector<Frame> frames; // the last ack_lag + 1 by step
+        Frame decoded;
+        Frame requantized; // decoded, applied and captured again
+        std::unique_ptr<sim::World> applied;
+        std::vector<std::uint8_t> buffer;
+        std::uint64_t snapshots {0};
+        std::uint64_t bytes {0};
+        std::uint64_t full_bytes {0}; // the same without a baseline
+        std::size_t max_bytes {0};
+        std::uint64_t failures {0};
+    };
+} // namespace delta
+
+#endif // SRC_DELTA_HPP_
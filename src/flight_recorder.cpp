@@ -0,0 +1,196 @@
+#include "flight_recorder.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "log_format.hpp"
+#include "logs.hpp"
+
+namespace {
+constexpr int fatal_signals[] {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+std::atomic<flight::Memory*> memory {nullptr};
+bool in_file {false};
+char dump_path[64];
+// the handler has to run even when the stack is what overflowed
+alignas(16) char alt_stack[64 * 1024];
+
+// only async-signal-safe calls from here on
+void write_dump(const flight::Memory* mem)
+{
+    const int fd {open(dump_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                       0644)};
+    if (fd == -1) { return; }
+
+    const char* p {reinterpret_cast<const char*>(mem)};
+    std::size_t left {sizeof(flight::Memory)};
+    while (left > 0) {
+        const ssize_t n {write(fd, p, left)};
+        if (n == -1 && errno == EINTR) { continue; }
+        if (n <= 0) { break; }
+        p += n;
+        left -= n;
+    }
+    close(fd);
+}
+
+void on_fatal_signal(int sig)
+{
+    flight::Memory* mem {memory.load(std::memory_order_relaxed)};
+    if (mem != nullptr) {
+        mem->header.crash_signal = sig;
+        // a mapped file already has everything
+        if (!in_file) { write_dump(mem); }
+    }
+    // SA_RESETHAND put the default action back, let it finish the process
+    raise(sig);
+}
+
+flight::Memory* map_memory(const char* path)
+{
+    int flags {MAP_PRIVATE | MAP_ANONYMOUS};
+    int fd {-1};
+    if (path != nullptr) {
+        fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1 || ftruncate(fd, sizeof(flight::Memory)) == -1) {
+            ERR("can not create flight recorder file ", path, ": ",
+                std::strerror(errno));
+            if (fd != -1) { close(fd); }
+            return nullptr;
+        }
+        flags = MAP_SHARED;
+    }
+
+    void* addr {mmap(nullptr, sizeof(flight::Memory), PROT_READ | PROT_WRITE,
+                     flags, fd, 0)};
+    // the mapping keeps the file open
+    if (fd != -1) { close(fd); }
+    if (addr == MAP_FAILED) {
+        ERR("flight recorder mmap failed: ", std::strerror(errno));
+        return nullptr;
+    }
+
+    return static_cast<flight::Memory*>(addr);
+}
+
+void install_handlers()
+{
+    stack_t ss {};
+    ss.ss_sp = alt_stack;
+    ss.ss_size = sizeof(alt_stack);
+    if (sigaltstack(&ss, nullptr) == -1) {
+        ERR("sigaltstack failed: ", std::strerror(errno));
+    }
+
+    struct sigaction sa {};
+    sa.sa_handler = on_fatal_signal;
+    sa.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    for (int sig : fatal_signals) {
+        sigaction(sig, &sa, nullptr);
+    }
+}
+} // namespace
+
+namespace flight {
+    void init(int argc, char** argv)
+    {
+        const char* path {std::getenv("RNB_FLIGHT")};
+        for (int i {1}; i < argc; ++i) {
+            if (std::string_view{argv[i]} == "--flight" && i + 1 < argc) {
+                path = argv[++i];
+            }
+        }
+
+        Memory* mem {map_memory(path)};
+        in_file = mem != nullptr && path != nullptr;
+        if (mem == nullptr && path != nullptr) {
+            // still better than nothing
+            mem = map_memory(nullptr);
+        }
+        if (mem == nullptr) { return; }
+
+        std::memcpy(mem->header.magic, magic, sizeof(magic));
+        mem->header.record_capacity = record_capacity;
+        mem->header.frame_capacity = frame_capacity;
+        mem->header.records_written = 0;
+        mem->header.frames_written = 0;
+        mem->header.crash_signal = 0;
+        mem->header.pid = static_cast<std::uint32_t>(getpid());
+        std::snprintf(dump_path, sizeof(dump_path), "crash_%u.flight",
+                      mem->header.pid);
+
+        memory.store(mem, std::memory_order_release);
+        install_handlers();
+        DBG(1, "flight recorder ", in_file ? path : "in memory");
+    }
+
+    void add_record(const logs::Record& rec, const logs::Site* site)
+    {
+        Memory* mem {memory.load(std::memory_order_acquire)};
+        if (mem == nullptr) { return; }
+
+        logs::Record& out {
+            mem->records[mem->header.records_written % record_capacity]};
+        out.ts_sec = rec.ts_sec;
+        out.ts_nsec = rec.ts_nsec;
+        out.site = 0;
+        out.level = rec.level;
+        out.flags = rec.flags;
+        out.size = 0;
+
+        // nothing in the copy may point into this process
+        logs::Encoder enc {out};
+        if (site != nullptr) {
+            enc.put_str("[");
+            enc.put_str(site->file);
+            enc.put_str(":");
+            enc.put_value(logs::Arg_type::u64, std::uint64_t{site->line});
+            enc.put_str("] ");
+        }
+        const char* end {rec.payload + rec.size};
+        for (const char* p {rec.payload}; p != nullptr && p < end;) {
+            const char* next {logs::next_arg(p)};
+            switch (static_cast<logs::Arg_type>(*p)) {
+                case logs::Arg_type::str: {
+                    std::uint16_t len;
+                    std::memcpy(&len, p + 1, sizeof(len));
+                    enc.put_str(std::string_view{p + 1 + sizeof(len), len});
+                } break;
+                case logs::Arg_type::lit: {
+                    const char* lit;
+                    std::memcpy(&lit, p + 1, sizeof(lit));
+                    enc.put_str(lit);
+                } break;
+                default:
+                    if (next != nullptr) {
+                        enc.put(static_cast<logs::Arg_type>(*p), p + 1,
+                                next - p - 1);
+                    }
+                    break;
+            }
+            p = next;
+        }
+
+        ++mem->header.records_written;
+    }
+
+    void add_frame(const Frame_sample& sample)
+    {
+        Memory* mem {memory.load(std::memory_order_relaxed)};
+        if (mem == nullptr) { return; }
+
+        mem->frames[mem->header.frames_written % frame_capacity] = sample;
+        ++mem->header.frames_written;
+    }
+} // namespace flight
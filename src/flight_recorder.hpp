@@ -0,0 +1,71 @@
+#ifndef SRC_FLIGHT_RECORDER_HPP_
+#define SRC_FLIGHT_RECORDER_HPP_
+
+/*******************************************************************************
+ * Flight recorder.
+ *
+ * Always on: keeps the last log records and per-frame samples in memory so
+ * there is something to look at after a crash or a hitch, without verbose
+ * logging. On a fatal signal (SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT) the
+ * memory is written to crash_<pid>.flight in the working directory.
+ *
+ * With --flight <file> (or RNB_FLIGHT) the memory is a shared mapping of that
+ * file instead, so it survives the process dying any way at all (including
+ * SIGKILL), the file then holds the latest run.
+ *
+ * Records are copied in by the log writer thread, so the last records that
+ * were logged but not written out yet when the process died are lost. They
+ * are stored self-contained (call site and literals turned into strings).
+ * dev/tools/logdecode prints either file.
+ ******************************************************************************/
+
+#include <cstdint>
+
+#include "logs.hpp"
+
+namespace flight {
+    constexpr char magic[8] {'R', 'N', 'B', 'F', 'L', 'T', '0', '2'};
+    constexpr std::uint32_t record_capacity {4096};
+    constexpr std::uint32_t frame_capacity {4096}; // a bit over a minute
+
+    struct Frame_sample final {
+        std::uint64_t frame;
+        std::uint64_t start_ns; // monotonic
+        std::uint32_t work_ns; // update and draw, without the sleep
+        // the entities in the World at the end of the frame
+        std::uint16_t ships;
+        std::uint16_t rocks;
+        std::uint32_t bullets;
+    };
+
+    /* what's in memory and in the files, in the byte order of the machine
+       that wrote it, entry i of a ring is at i % capacity */
+    struct Header final {
+        char magic[8];
+        std::uint32_t record_capacity;
+        std::uint32_t frame_capacity;
+        std::uint64_t records_written;
+        std::uint64_t frames_written;
+        std::int32_t crash_signal; // 0 if still running or exited normally
+        std::uint32_t pid;
+    };
+
+    struct Memory final {
+        Header header;
+        logs::Record records[record_capacity];
+        Frame_sample frames[frame_capacity];
+    };
+
+    /* sets up the memory and the signal handlers, "--flight <file>" or
+       RNB_FLIGHT=<file> to keep it in a file, call after logs::init() */
+    void init(int argc, char** argv);
+
+    /* only called by the log writer thread, the entry being written when the
+       process dies may be torn */
+    void add_record(const logs::Record& rec, const logs::Site* site);
+
+    // only called by the main loop
+    void add_frame(const Frame_sample& sample);
+} // namespace flight
+
+#endif // SRC_FLIGHT_RECORDER_HPP_
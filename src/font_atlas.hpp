@@ -0,0 +1,39 @@
+#ifndef SRC_FONT_ATLAS_HPP_
+#define SRC_FONT_ATLAS_HPP_
+
+/* Layout of the font atlases in gfx/fonts (shared with dev/tools).
+ *
+ * Glyphs sit in a grid of 8 columns, printable ASCII (32-126) in order as
+ * listed by dev/tools/charlist, with the first row right aligned so that
+ * '!' starts the second row:
+ *   row 0:  ? ? ? ? ? ? ? ' '   (the '?' cells stand in for unknown chars)
+ *   row 1:  ! " # $ % & ' (
+ *   ...
+ *   row 12: y z { | } ~
+ * Row 0 is at the top of the image. */
+
+namespace font_atlas {
+    constexpr char first_char {32};
+    constexpr char last_char {126};
+    constexpr int columns {8};
+    constexpr int rows {13};
+    // size of one glyph cell in the source bitmap atlas, in pixels
+    constexpr int glyph_w {8};
+    constexpr int glyph_h {16};
+
+    // grid cell of a char, counted from the top left
+    struct Cell {
+        int col;
+        int row;
+    };
+
+    constexpr Cell cell(char c)
+    {
+        // cells 0-6 are fallback glyphs, ' ' is cell 7
+        const int i {
+            (c < first_char || c > last_char) ? 0 : c - first_char + 7};
+        return Cell{i % columns, i / columns};
+    }
+} // namespace font_atlas
+
+#endif // SRC_FONT_ATLAS_HPP_
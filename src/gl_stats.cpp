@@ -0,0 +1,35 @@
+#include "gl_stats.hpp"
+
+#include <cstddef>
+#include <cstdio>
+
+namespace {
+gl_stats::Counters last {};
+} // namespace
+
+namespace gl_stats {
+    Counters current {};
+
+    void end_frame()
+    {
+        last = current;
+        current = Counters{};
+    }
+
+    const Counters& last_frame() { return last; }
+
+    std::size_t format(const Counters& c, char* buf, std::size_t size)
+    {
+        const int len {std::snprintf(
+            buf, size,
+            "draws %u (%u verts) progs %u unis %u uploads %u (%llu B) "
+            "tex %u state %u",
+            c.draw_calls, c.vertices, c.program_switches, c.uniform_uploads,
+            c.buffer_uploads, static_cast<unsigned long long>(c.upload_bytes),
+            c.texture_binds, c.state_changes)};
+        if (len < 0 || size == 0) { return 0; }
+
+        return static_cast<std::size_t>(len) < size ?
+            static_cast<std::size_t>(len) : size - 1;
+    }
+} // namespace gl_stats
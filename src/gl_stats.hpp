@@ -0,0 +1,146 @@
+#ifndef SRC_GL_STATS_HPP_
+#define SRC_GL_STATS_HPP_
+
+/*******************************************************************************
+ * Per-frame GL call counters.
+ *
+ * Thin wrappers around the GL calls the renderer makes, each one counts what
+ * it does before calling through. Use them instead of the gl* functions so
+ * the numbers stay honest, end_frame() once per frame makes the counts of the
+ * frame available through last_frame().
+ *
+ * GL is only called from the main thread, so are these, nothing is atomic.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+
+#include <GL/glew.h>
+
+namespace gl_stats {
+    struct Counters final {
+        std::uint32_t draw_calls;
+        std::uint32_t vertices; // submitted by draw calls
+        std::uint32_t program_switches;
+        std::uint32_t uniform_uploads;
+        std::uint32_t buffer_uploads;
+        std::uint64_t upload_bytes;
+        std::uint32_t texture_binds;
+        // buffer binds, vertex attrib setup, enable/disable, blend, etc.
+        std::uint32_t state_changes;
+    };
+
+    // the frame being drawn
+    extern Counters current;
+
+    // finishes the current frame's counts and starts over
+    void end_frame();
+    // counts of the last finished frame
+    const Counters& last_frame();
+
+    /* one line summary of 'c' into 'buf', truncated to fit 'size', returns
+       the length written */
+    std::size_t format(const Counters& c, char* buf, std::size_t size);
+
+    inline void draw_arrays(GLenum mode, GLint first, GLsizei count)
+    {
+        ++current.draw_calls;
+        current.vertices += count;
+        glDrawArrays(mode, first, count);
+    }
+
+    inline void use_program(GLuint program)
+    {
+        ++current.program_switches;
+        glUseProgram(program);
+    }
+
+    inline void uniform_3fv(GLint loc, GLsizei count, const GLfloat* value)
+    {
+        ++current.uniform_uploads;
+        glUniform3fv(loc, count, value);
+    }
+
+    inline void uniform_matrix_4fv(
+        GLint loc,
+        GLsizei count,
+        GLboolean transpose,
+        const GLfloat* value)
+    {
+        ++current.uniform_uploads;
+        glUniformMatrix4fv(loc, count, transpose, value);
+    }
+
+    inline void buffer_data(
+        GLenum target,
+        GLsizeiptr size,
+        const void* data,
+        GLenum usage)
+    {
+        ++current.buffer_uploads;
+        current.upload_bytes += size;
+        glBufferData(target, size, data, usage);
+    }
+
+    inline void bind_texture(GLenum target, GLuint texture)
+    {
+        ++current.texture_binds;
+        glBindTexture(target, texture);
+    }
+
+    inline void bind_buffer(GLenum target, GLuint buffer)
+    {
+        ++current.state_changes;
+        glBindBuffer(target, buffer);
+    }
+
+    inline void vertex_attrib_pointer(
+        GLuint index,
+        GLint size,
+        GLenum type,
+        GLboolean normalized,
+        GLsizei stride,
+        const void* pointer)
+    {
+        ++current.state_changes;
+        glVertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+
+    inline void enable_vertex_attrib_array(GLuint index)
+    {
+        ++current.state_changes;
+        glEnableVertexAttribArray(index);
+    }
+
+    inline void disable_vertex_attrib_array(GLuint index)
+    {
+        ++current.state_changes;
+        glDisableVertexAttribArray(index);
+    }
+
+    inline void enable(GLenum cap)
+    {
+        ++current.state_changes;
+        glEnable(cap);
+    }
+
+    inline void disable(GLenum cap)
+    {
+        ++current.state_changes;
+        glDisable(cap);
+    }
+
+    inline void blend_func(GLenum sfactor, GLenum dfactor)
+    {
+        ++current.state_changes;
+        glBlendFunc(sfactor, dfactor);
+    }
+
+    inline void polygon_mode(GLenum face, GLenum mode)
+    {
+        ++current.state_changes;
+        glPolygonMode(face, mode);
+    }
+} // namespace gl_stats
+
+#endif // SRC_GL_STATS_HPP_
@@ -0,0 +1,115 @@
+#ifndef SRC_HASH_HPP_
+#define SRC_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*******************************************************************************
+ * XXH64, the 64 bit xxHash by Yann Collet: fast, well distributed,
+ * non-cryptographic. Written out here instead of pulling in the library, this
+ * is all of it we need. Reads input in the machine's byte order, so hashes
+ * match the reference implementation only on little endian machines, and
+ * only compare with hashes from a machine of the same byte order.
+ ******************************************************************************/
+
+namespace hash {
+    namespace detail {
+        constexpr std::uint64_t prime1 {11400714785074694791ULL};
+        constexpr std::uint64_t prime2 {14029467366897019727ULL};
+        constexpr std::uint64_t prime3 {1609587929392839161ULL};
+        constexpr std::uint64_t prime4 {9650029242287828579ULL};
+        constexpr std::uint64_t prime5 {2870177450012600261ULL};
+
+        inline std::uint64_t rotl(std::uint64_t x, int r)
+        {
+            return (x << r) | (x >> (64 - r));
+        }
+
+        inline std::uint64_t read64(const unsigned char* p)
+        {
+            std::uint64_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint32_t read32(const unsigned char* p)
+        {
+            std::uint32_t v;
+            std::memcpy(&v, p, sizeof(v));
+            return v;
+        }
+
+        inline std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+        {
+            acc += input * prime2;
+            acc = rotl(acc, 31);
+            return acc * prime1;
+        }
+
+        inline std::uint64_t merge(std::uint64_t acc, std::uint64_t val)
+        {
+            acc ^= round(0, val);
+            return acc * prime1 + prime4;
+        }
+    } // namespace detail
+
+    inline std::uint64_t xxh64(
+        const void* data,
+        std::size_t len,
+        std::uint64_t seed = 0)
+    {
+        using namespace detail;
+
+        const auto* p {static_cast<const unsigned char*>(data)};
+        const unsigned char* const end {p + len};
+        std::uint64_t h;
+
+        if (len >= 32) {
+            std::uint64_t v1 {seed + prime1 + prime2};
+            std::uint64_t v2 {seed + prime2};
+            std::uint64_t v3 {seed};
+            std::uint64_t v4 {seed - prime1};
+            do {
+                v1 = round(v1, read64(p));
+                v2 = round(v2, read64(p + 8));
+                v3 = round(v3, read64(p + 16));
+                v4 = round(v4, read64(p + 24));
+                p += 32;
+            } while (end - p >= 32);
+
+            h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+            h = merge(h, v1);
+            h = merge(h, v2);
+            h = merge(h, v3);
+            h = merge(h, v4);
+        } else {
+            h = seed + prime5;
+        }
+        h += len;
+
+        for (; end - p >= 8; p += 8) {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * prime1 + prime4;
+        }
+        if (end - p >= 4) {
+            h ^= read32(p) * prime1;
+            h = rotl(h, 23) * prime2 + prime3;
+            p += 4;
+        }
+        for (; p < end; ++p) {
+            h ^= *p * prime5;
+            h = rotl(h, 11) * prime1;
+        }
+
+        h ^= h >> 33;
+        h *= prime2;
+        h ^= h >> 29;
+        h *= prime3;
+        h ^= h >> 32;
+
+        return h;
+    }
+} // namespace hash
+
+#endif // SRC_HASH_HPP_
@@ -0,0 +1,93 @@
+#include "log_format.hpp"
+
+#include <time.h>
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+template<typename T>
+T read_value(const char* p)
+{
+    T v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+} // namespace
+
+namespace logs {
+    const char* next_arg(const char* arg)
+    {
+        const auto type {static_cast<Arg_type>(*arg++)};
+        switch (type) {
+            case Arg_type::i64: return arg + sizeof(std::int64_t);
+            case Arg_type::u64: return arg + sizeof(std::uint64_t);
+            case Arg_type::f64: return arg + sizeof(double);
+            case Arg_type::chr: return arg + sizeof(char);
+            case Arg_type::boolean: return arg + sizeof(bool);
+            case Arg_type::ptr: return arg + sizeof(const void*);
+            case Arg_type::str:
+                return arg + sizeof(std::uint16_t)
+                    + read_value<std::uint16_t>(arg);
+            case Arg_type::lit: return arg + sizeof(const char*);
+        }
+        // corrupt payload, nothing sensible after it
+        return nullptr;
+    }
+
+    void format_record(
+        const Record& rec,
+        const Site* site,
+        Literal_lookup lookup,
+        void* ctx,
+        std::ostream& out)
+    {
+        switch (rec.level) {
+            case Level::info: out << "I "; break;
+            case Level::dbg: out << "D "; break;
+            case Level::err: out << "E "; break;
+        }
+        if (rec.flags & Record::mono_clock) {
+            out << rec.ts_sec * 1000000000 + rec.ts_nsec << " ";
+        } else {
+            const struct timespec ts {rec.ts_sec, rec.ts_nsec};
+            out << timestamp_nano_at(&ts) << " ";
+        }
+        if (site != nullptr) {
+            out << "[" << site->file << ":" << site->line << "] ";
+        }
+
+        const char* p {rec.payload};
+        const char* end {rec.payload + rec.size};
+        while (p != nullptr && p < end) {
+            const char* arg {p + 1};
+            switch (static_cast<Arg_type>(*p)) {
+                case Arg_type::i64: out << read_value<std::int64_t>(arg); break;
+                case Arg_type::u64:
+                    out << read_value<std::uint64_t>(arg);
+                    break;
+                case Arg_type::f64: out << read_value<double>(arg); break;
+                case Arg_type::chr: out << *arg; break;
+                case Arg_type::boolean: out << read_value<bool>(arg); break;
+                case Arg_type::ptr: out << read_value<const void*>(arg); break;
+                case Arg_type::str:
+                    out.write(arg + sizeof(std::uint16_t),
+                              read_value<std::uint16_t>(arg));
+                    break;
+                case Arg_type::lit: {
+                    const auto addr {reinterpret_cast<std::uint64_t>(
+                        read_value<const char*>(arg))};
+                    out << lookup(addr, ctx);
+                } break;
+            }
+            p = next_arg(p);
+        }
+        if (rec.flags & Record::truncated) { out << " [...]"; }
+        out << '\n';
+    }
+} // namespace logs
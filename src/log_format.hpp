@@ -0,0 +1,47 @@
+#ifndef SRC_LOG_FORMAT_HPP_
+#define SRC_LOG_FORMAT_HPP_
+
+/* Turning log records into text, shared by the logger's writer thread and
+ * dev/tools/logdecode, plus the layout of binary log files.
+ *
+ * A binary log starts with bin_magic followed by chunks, each starting with a
+ * Bin_tag char. All values are in the byte order of the machine that wrote
+ * the file.
+ *   'S' site:    u32 id, u32 line, u8 category, u16 length, file name
+ *   'L' literal: u64 address, u16 length, the chars
+ *   'R' record:  the Record up to (excluding) its payload, then 'size' bytes
+ *                of payload
+ * Sites and literals come before the first record that refers to them. */
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+
+#include "logs.hpp"
+
+namespace logs {
+    constexpr char bin_magic[8] {'R', 'N', 'B', 'L', 'O', 'G', '0', '1'};
+
+    enum class Bin_tag : char {
+        site = 'S',
+        literal = 'L',
+        record = 'R'
+    };
+
+    // what a string literal argument stored as 'addr' says
+    using Literal_lookup = std::string_view (*)(std::uint64_t addr, void* ctx);
+
+    // start of the argument after the one at 'arg' in a record's payload
+    const char* next_arg(const char* arg);
+
+    /* writes 'rec' as one line of text, 'site' is nullptr for records without
+       a call site, literals are resolved with lookup(addr, ctx) */
+    void format_record(
+        const Record& rec,
+        const Site* site,
+        Literal_lookup lookup,
+        void* ctx,
+        std::ostream& out);
+} // namespace logs
+
+#endif // SRC_LOG_FORMAT_HPP_
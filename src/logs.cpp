@@ -0,0 +1,421 @@
+#include "logs.hpp"
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "flight_recorder.hpp"
+#include "log_format.hpp"
+#include "trace.hpp"
+
+namespace {
+constexpr std::uint64_t ring_size {8192}; // records, must be a power of 2
+constexpr std::uint64_t ring_mask {ring_size - 1};
+// how long the writer sleeps when there's nothing to write
+constexpr std::chrono::milliseconds idle_sleep {1};
+// call sites that can be registered, id 0 is reserved for "no site"
+constexpr std::uint32_t max_sites {4096};
+
+logs::Site sites[max_sites];
+std::atomic<std::uint32_t> site_count {1};
+
+// literals are stored by address, in this process that's all it takes
+std::string_view own_literal(std::uint64_t addr, void*)
+{
+    return reinterpret_cast<const char*>(addr);
+}
+
+const logs::Site* find_site(std::uint32_t id)
+{
+    return id == 0 || id >= max_sites ? nullptr : &sites[id];
+}
+
+/* bounded MPMC queue after D. Vyukov, only used with a single consumer: a
+   slot is free for the producer claiming position 'pos' when seq == pos, and
+   holds a committed record for the consumer when seq == pos + 1 */
+struct alignas(64) Slot {
+    std::atomic<std::uint64_t> seq;
+    std::uint64_t pos; // position it was claimed at, for commit()
+    logs::Record rec;
+};
+static_assert(sizeof(Slot) == 256, "keep slots at four cache lines");
+
+class Backend final {
+public:
+    Backend();
+    ~Backend();
+
+    logs::Record* claim();
+    void commit(logs::Record* rec);
+    void flush();
+    // switch to binary output into 'file', takes ownership
+    void write_binary(std::FILE* file);
+
+private:
+    // writer thread
+    void run();
+    // format and write out all committed records, false if there were none
+    bool drain();
+    void write_record(const logs::Record& rec);
+
+    std::unique_ptr<Slot[]> slots;
+    alignas(64) std::atomic<std::uint64_t> enqueue_pos {0};
+    alignas(64) std::atomic<std::uint64_t> written_pos {0};
+    std::atomic<std::uint64_t> dropped {0};
+    std::atomic<bool> running {true};
+    std::atomic<std::FILE*> bin_file {nullptr};
+
+    // writer thread only
+    std::uint64_t dequeue_pos {0};
+    std::uint64_t dropped_reported {0};
+    std::ostringstream out_batch;
+    std::ostringstream err_batch;
+    // what the binary log already has
+    std::vector<bool> sites_written;
+    std::unordered_set<std::uint64_t> literals_written;
+
+    std::thread writer; // last, everything above must exist before it starts
+};
+
+Backend::Backend()
+: slots {new Slot[ring_size]}
+{
+    for (std::uint64_t i {0}; i < ring_size; ++i) {
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    writer = std::thread(&Backend::run, this);
+}
+
+Backend::~Backend()
+{
+    running.store(false, std::memory_order_release);
+    writer.join();
+    if (std::FILE* file {bin_file.load()}; file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+logs::Record* Backend::claim()
+{
+    std::uint64_t pos {enqueue_pos.load(std::memory_order_relaxed)};
+    for (;;) {
+        Slot& slot {slots[pos & ring_mask]};
+        const std::uint64_t seq {slot.seq.load(std::memory_order_acquire)};
+        const auto diff {
+            static_cast<std::int64_t>(seq) - static_cast<std::int64_t>(pos)};
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(
+                    pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.pos = pos;
+                return &slot.rec;
+            }
+        } else if (diff < 0) {
+            // writer hasn't caught up, never wait for it
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Backend::commit(logs::Record* rec)
+{
+    const std::size_t idx {static_cast<std::size_t>(
+        (reinterpret_cast<char*>(rec) - reinterpret_cast<char*>(&slots[0].rec))
+        / sizeof(Slot))};
+    Slot& slot {slots[idx]};
+    slot.seq.store(slot.pos + 1, std::memory_order_release);
+}
+
+void Backend::flush()
+{
+    const std::uint64_t target {enqueue_pos.load(std::memory_order_acquire)};
+    while (written_pos.load(std::memory_order_acquire) < target &&
+           running.load(std::memory_order_acquire))
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void Backend::write_binary(std::FILE* file)
+{
+    // everything logged so far still goes out as text
+    flush();
+    std::fwrite(logs::bin_magic, sizeof(logs::bin_magic), 1, file);
+    bin_file.store(file, std::memory_order_release);
+}
+
+void Backend::run()
+{
+    trace::set_thread_name("log writer");
+    while (running.load(std::memory_order_acquire)) {
+        if (!drain()) { std::this_thread::sleep_for(idle_sleep); }
+    }
+    // whatever was logged up to shutdown
+    while (drain()) {}
+}
+
+bool Backend::drain()
+{
+    std::FILE* bin {bin_file.load(std::memory_order_acquire)};
+    bool any {false};
+    for (;;) {
+        Slot& slot {slots[dequeue_pos & ring_mask]};
+        if (slot.seq.load(std::memory_order_acquire) != dequeue_pos + 1) {
+            break;
+        }
+
+        const logs::Record& rec {slot.rec};
+        const bool is_err {rec.level == logs::Level::err};
+        if (bin != nullptr) { write_record(rec); }
+        // errors are always seen, whatever the output is
+        if (bin == nullptr || is_err) {
+            logs::format_record(rec, find_site(rec.site), own_literal, nullptr,
+                                is_err ? err_batch : out_batch);
+        }
+        flight::add_record(rec, find_site(rec.site));
+        slot.seq.store(dequeue_pos + ring_size, std::memory_order_release);
+        ++dequeue_pos;
+        any = true;
+    }
+
+    const std::uint64_t dropped_now {dropped.load(std::memory_order_relaxed)};
+    if (dropped_now != dropped_reported) {
+        err_batch << "E " << (dropped_now - dropped_reported)
+                  << " log records dropped, ring buffer full\n";
+        dropped_reported = dropped_now;
+        any = true;
+    }
+
+    if (!any) { return false; }
+    TRACE_SCOPE("log write");
+
+    // one write and flush per batch instead of per line
+    if (out_batch.tellp() > 0) {
+        std::cout << out_batch.str() << std::flush;
+        out_batch.str("");
+    }
+    if (err_batch.tellp() > 0) {
+        std::cerr << err_batch.str() << std::flush;
+        err_batch.str("");
+    }
+    if (bin != nullptr) { std::fflush(bin); }
+    written_pos.store(dequeue_pos, std::memory_order_release);
+
+    return true;
+}
+
+template<typename T>
+void write_value(std::FILE* file, T v) { std::fwrite(&v, sizeof(v), 1, file); }
+
+void write_str(std::FILE* file, std::string_view str)
+{
+    write_value(file, static_cast<std::uint16_t>(str.size()));
+    std::fwrite(str.data(), 1, str.size(), file);
+}
+
+void Backend::write_record(const logs::Record& rec)
+{
+    std::FILE* file {bin_file.load(std::memory_order_relaxed)};
+
+    if (const logs::Site* site {find_site(rec.site)}; site != nullptr) {
+        if (sites_written.size() <= rec.site) {
+            sites_written.resize(rec.site + 1);
+        }
+        if (!sites_written[rec.site]) {
+            write_value(file, logs::Bin_tag::site);
+            write_value(file, rec.site);
+            write_value(file, site->line);
+            write_value(file, site->category);
+            write_str(file, site->file);
+            sites_written[rec.site] = true;
+        }
+    }
+
+    const char* end {rec.payload + rec.size};
+    for (const char* p {rec.payload}; p != nullptr && p < end;
+         p = logs::next_arg(p))
+    {
+        if (static_cast<logs::Arg_type>(*p) != logs::Arg_type::lit) {
+            continue;
+        }
+        const char* lit;
+        std::memcpy(&lit, p + 1, sizeof(lit));
+        const auto addr {reinterpret_cast<std::uint64_t>(lit)};
+        if (literals_written.insert(addr).second) {
+            write_value(file, logs::Bin_tag::literal);
+            write_value(file, addr);
+            write_str(file, lit);
+        }
+    }
+
+    write_value(file, logs::Bin_tag::record);
+    std::fwrite(&rec, offsetof(logs::Record, payload), 1, file);
+    std::fwrite(rec.payload, 1, rec.size, file);
+}
+
+Backend& backend()
+{
+    static Backend instance;
+    return instance;
+}
+
+constexpr int level_off {-1};
+constexpr int level_all {INT_MAX};
+
+constexpr std::array<std::string_view, static_cast<int>(logs::Category::count)>
+category_names {"general", "render", "sim", "assets", "input", "net"};
+
+int default_level()
+{
+#ifdef DEBUG
+    return (DEBUG) == -1 ? level_all : (DEBUG);
+#else
+    return level_off;
+#endif // DEBUG
+}
+
+bool parse_level(std::string_view str, int& level)
+{
+    if (str == "off") {
+        level = level_off;
+        return true;
+    }
+    if (str == "all") {
+        level = level_all;
+        return true;
+    }
+    const auto [end, ec] {
+        std::from_chars(str.data(), str.data() + str.size(), level)};
+
+    return ec == std::errc{} && end == str.data() + str.size();
+}
+} // namespace
+
+namespace logs {
+    std::atomic<bool> mono_timestamps {false};
+
+    std::atomic<int> dbg_levels[static_cast<int>(Category::count)] {
+        default_level(), default_level(), default_level(), default_level(),
+        default_level(), default_level()};
+
+    std::uint32_t register_site(
+        const char* file,
+        std::uint32_t line,
+        Category category)
+    {
+        const std::uint32_t id {
+            site_count.fetch_add(1, std::memory_order_relaxed)};
+        if (id >= max_sites) { return 0; }
+        /* the record using the id is committed after this by the same thread,
+           which makes the entry visible to the writer */
+        sites[id] = Site{file, line, category};
+        return id;
+    }
+
+    Record* claim() { return backend().claim(); }
+    void commit(Record* rec) { backend().commit(rec); }
+    void flush() { backend().flush(); }
+
+    bool set_dbg_levels(std::string_view spec)
+    {
+        std::array<int, static_cast<int>(Category::count)> levels;
+        for (std::size_t i {0}; i < levels.size(); ++i) {
+            levels[i] = dbg_levels[i].load(std::memory_order_relaxed);
+        }
+
+        while (!spec.empty()) {
+            const std::size_t comma {spec.find(',')};
+            const std::string_view entry {spec.substr(0, comma)};
+            spec = comma == std::string_view::npos ?
+                std::string_view{} : spec.substr(comma + 1);
+
+            const std::size_t eq {entry.find('=')};
+            int level;
+            if (eq == std::string_view::npos) {
+                if (!parse_level(entry, level)) { return false; }
+                levels.fill(level);
+                continue;
+            }
+
+            const std::string_view name {entry.substr(0, eq)};
+            if (!parse_level(entry.substr(eq + 1), level)) { return false; }
+            std::size_t cat {0};
+            while (cat < category_names.size() && category_names[cat] != name) {
+                ++cat;
+            }
+            if (cat == category_names.size()) { return false; }
+            levels[cat] = level;
+        }
+
+        for (std::size_t i {0}; i < levels.size(); ++i) {
+            dbg_levels[i].store(levels[i], std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+    void init(int argc, char** argv)
+    {
+        const char* env {std::getenv("RNB_LOG")};
+        if (env != nullptr && !set_dbg_levels(env)) {
+            err("bad RNB_LOG value: ", env);
+        }
+        const char* ts_mode {std::getenv("RNB_LOG_TS")};
+        const char* bin_path {std::getenv("RNB_LOG_BIN")};
+
+        for (int i {1}; i < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            const char* spec {nullptr};
+            if (arg == "--log" && i + 1 < argc) {
+                spec = argv[++i];
+            } else if (arg.substr(0, 6) == "--log=") {
+                spec = argv[i] + 6;
+            } else if (arg == "--log-ts" && i + 1 < argc) {
+                ts_mode = argv[++i];
+            } else if (arg == "--log-bin" && i + 1 < argc) {
+                bin_path = argv[++i];
+            }
+            if (spec != nullptr && !set_dbg_levels(spec)) {
+                err("bad --log value: ", spec);
+            }
+        }
+
+        if (ts_mode != nullptr) {
+            const std::string_view mode {ts_mode};
+            if (mode == "mono" || mode == "wall") {
+                mono_timestamps.store(mode == "mono");
+            } else {
+                err("bad log timestamp mode (wall|mono): ", ts_mode);
+            }
+        }
+
+        if (bin_path != nullptr) {
+            std::FILE* file {std::fopen(bin_path, "wb")};
+            if (file == nullptr) {
+                err("can not open binary log ", bin_path, ": ",
+                    std::strerror(errno));
+            } else {
+                info("logging to ", bin_path, " in binary");
+                backend().write_binary(file);
+            }
+        }
+    }
+} // namespace logs
@@ -1,45 +1,284 @@
 #ifndef SRC_LOGS_HPP_
 #define SRC_LOGS_HPP_
 
-#include <iostream>
-#include <fstream>
+/*******************************************************************************
+ * Logging.
+ *
+ * Call sites don't format anything, they copy their arguments as raw values
+ * into a record in a lock-free ring buffer (many producers, one consumer). A
+ * background thread formats the records and writes them out in batches, so a
+ * log call costs a clock read plus a few copies and never waits on I/O. If the
+ * ring is full the record is dropped and counted rather than blocking.
+ *
+ * Arguments are stored by type: numbers, chars and bools as is, strings as
+ * copies (truncated if the record runs out of space). String literals are only
+ * stored as a pointer, which is why a 'const char[N]' argument must outlive the
+ * program (fine for literals, not for local const arrays, pass those as
+ * std::string instead). Anything else is formatted with operator<< on the
+ * calling thread as a fallback.
+ *
+ * INFO and ERR log with the call site, registered once per site, like the
+ * debug macros do; the text log shows it as [file:line].
+ *
+ * Debug logging (DBG, DBG_CAT) is compiled into every build. Its verbosity is
+ * set at runtime per category, from the RNB_LOG environment variable and the
+ * --log command line option (see set_dbg_levels() for the format). A disabled
+ * DBG costs one relaxed atomic load, its arguments are not evaluated.
+ *
+ * With --log-bin <file> (or RNB_LOG_BIN) nothing is formatted at all: records
+ * are written to the file as they are in the ring, call sites, and string
+ * literals once, as they are first seen (format in log_format.hpp). Errors
+ * still go to stderr as text too. dev/tools/logdecode turns the file into the
+ * same text the normal log would have had.
+ ******************************************************************************/
+
+#include <time.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <sstream>
 #include <string>
-
-extern "C" {
-#include "timestamp.h"
-}
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace logs {
-    static std::ostream* std_out = &std::cout;
-    static std::ostream* err_out = &std::cerr;
+    enum class Level : std::uint8_t {
+        info,
+        dbg,
+        err // goes to the error output (stderr)
+    };
+
+    // what a debug message is about, each has its own verbosity level
+    enum class Category : std::uint8_t {
+        general,
+        render,
+        sim,
+        assets,
+        input,
+        net,
+        count
+    };
+
+    // debug verbosity per category, messages up to it are logged, -1 is off
+    extern std::atomic<int> dbg_levels[static_cast<int>(Category::count)];
+
+    inline bool dbg_enabled(Category cat, int verbosity)
+    {
+        return dbg_levels[static_cast<int>(cat)].load(
+            std::memory_order_relaxed) >= verbosity;
+    }
+
+    /* sets levels from a comma separated list of 'category=level' and/or a
+       bare level for all categories, e.g. "2", "render=3,sim=1", "1,input=5"
+       levels are numbers, "off" or "all"
+       returns false and changes nothing if the spec is malformed */
+    bool set_dbg_levels(std::string_view spec);
+
+    /* logging set up from the environment and command line
+       debug levels: DEBUG's value in debug builds, off otherwise, then
+       overridden by RNB_LOG and then each "--log <spec>" / "--log=<spec>"
+       timestamps: "--log-ts mono" or RNB_LOG_TS=mono for monotonic ns
+       binary log: "--log-bin <file>" or RNB_LOG_BIN=<file> */
+    void init(int argc, char** argv);
+
+    // how arguments are tagged inside a record's payload
+    enum class Arg_type : std::uint8_t {
+        i64,
+        u64,
+        f64,
+        chr,
+        boolean,
+        ptr,
+        str, // std::uint16_t length followed by the chars
+        lit  // pointer to a string literal
+    };
+
+    struct Record final {
+        static constexpr std::size_t payload_size {220};
+
+        // Record::flags
+        static constexpr std::uint8_t truncated {1}; // not all args fit
+        static constexpr std::uint8_t mono_clock {2}; // ts is CLOCK_MONOTONIC
+
+        std::int64_t ts_sec; // time of the call, wall clock by default
+        std::int32_t ts_nsec;
+        std::uint32_t site; // call site id, 0 if none
+        Level level;
+        std::uint8_t flags;
+        std::uint16_t size; // bytes used in payload
+        char payload[payload_size];
+    };
+
+    // where a log call is in the source, registered once per call site
+    struct Site final {
+        const char* file;
+        std::uint32_t line;
+        Category category;
+    };
+
+    /* registers a call site, returns its id for log_at() or 0 (no site) if
+       the site table is full */
+    std::uint32_t register_site(
+        const char* file,
+        std::uint32_t line,
+        Category category);
+
+    /* log raw monotonic nanoseconds instead of the local wall clock time,
+       cheaper to take and unaffected by clock adjustments */
+    extern std::atomic<bool> mono_timestamps;
+
+    /* reserve a record for writing, returns nullptr if the ring is full (the
+       record is then counted as dropped), must be followed by commit() */
+    Record* claim();
+    void commit(Record* rec);
+
+    // write out everything logged so far, blocks until done
+    void flush();
+
+    // copies tagged arguments into a record's payload
+    class Encoder final {
+    public:
+        explicit Encoder(Record& rec): rec {rec} {}
+
+        void put(Arg_type type, const void* data, std::size_t size)
+        {
+            if (rec.size + 1 + size > Record::payload_size) {
+                rec.flags |= Record::truncated;
+                return;
+            }
+            rec.payload[rec.size] = static_cast<char>(type);
+            std::memcpy(&rec.payload[rec.size + 1], data, size);
+            rec.size += 1 + size;
+        }
+
+        void put_str(std::string_view str)
+        {
+            constexpr std::size_t header {1 + sizeof(std::uint16_t)};
+            if (rec.size + header > Record::payload_size) {
+                rec.flags |= Record::truncated;
+                return;
+            }
+            std::size_t len {str.size()};
+            if (rec.size + header + len > Record::payload_size) {
+                len = Record::payload_size - rec.size - header;
+                rec.flags |= Record::truncated;
+            }
+            const auto len16 {static_cast<std::uint16_t>(len)};
+            rec.payload[rec.size] = static_cast<char>(Arg_type::str);
+            std::memcpy(&rec.payload[rec.size + 1], &len16, sizeof(len16));
+            std::memcpy(&rec.payload[rec.size + header], str.data(), len);
+            rec.size += header + len;
+        }
+
+        template<typename T>
+        void put_value(Arg_type type, T value) { put(type, &value, sizeof(T)); }
+
+    private:
+        Record& rec;
+    };
+
+    // string literals come in as references to const char arrays
+    template<typename T>
+    struct Is_literal: std::false_type {};
+    template<std::size_t N>
+    struct Is_literal<const char[N]>: std::true_type {};
+
+    template<typename T>
+    void encode(Encoder& enc, T&& arg)
+    {
+        using V = std::remove_cv_t<std::remove_reference_t<T>>;
+
+        if constexpr (Is_literal<std::remove_reference_t<T>>::value) {
+            enc.put_value(Arg_type::lit, static_cast<const char*>(arg));
+        } else if constexpr (std::is_same_v<V, bool>) {
+            enc.put_value(Arg_type::boolean, arg);
+        } else if constexpr (
+            std::is_same_v<V, char> || std::is_same_v<V, signed char> ||
+            std::is_same_v<V, unsigned char>)
+        {
+            enc.put_value(Arg_type::chr, static_cast<char>(arg));
+        } else if constexpr (std::is_enum_v<V>) {
+            encode(enc, static_cast<std::underlying_type_t<V>>(arg));
+        } else if constexpr (std::is_integral_v<V> && std::is_signed_v<V>) {
+            enc.put_value(Arg_type::i64, static_cast<std::int64_t>(arg));
+        } else if constexpr (std::is_integral_v<V>) {
+            enc.put_value(Arg_type::u64, static_cast<std::uint64_t>(arg));
+        } else if constexpr (std::is_floating_point_v<V>) {
+            enc.put_value(Arg_type::f64, static_cast<double>(arg));
+        } else if constexpr (
+            std::is_convertible_v<T, const char*> ||
+            std::is_convertible_v<T, std::string_view>)
+        {
+            // char* can be null, an ostream would refuse to print it anyway
+            if constexpr (
+                std::is_convertible_v<T, const char*> &&
+                !std::is_array_v<std::remove_reference_t<T>>)
+            {
+                if (static_cast<const char*>(arg) == nullptr) {
+                    enc.put_str("(null)");
+                    return;
+                }
+            }
+            enc.put_str(std::string_view{arg});
+        } else if constexpr (std::is_pointer_v<V>) {
+            enc.put_value(Arg_type::ptr, static_cast<const void*>(arg));
+        } else {
+            // slow path, anything else that can be streamed
+            std::ostringstream ss;
+            ss << arg;
+            enc.put_str(ss.str());
+        }
+    }
+
+    template<typename... Ts>
+    void log_at(std::uint32_t site, Level level, Ts&&... args)
+    {
+        Record* rec {claim()};
+        if (rec == nullptr) { return; }
+
+        const bool mono {mono_timestamps.load(std::memory_order_relaxed)};
+        timespec ts;
+        clock_gettime(mono ? CLOCK_MONOTONIC : CLOCK_REALTIME, &ts);
+        rec->ts_sec = ts.tv_sec;
+        rec->ts_nsec = ts.tv_nsec;
+        rec->site = site;
+        rec->level = level;
+        rec->flags = mono ? Record::mono_clock : 0;
+        rec->size = 0;
+
+        Encoder enc {*rec};
+        (encode(enc, std::forward<Ts>(args)), ...);
+        commit(rec);
+    }
 
     template<typename... Ts>
-    void print(std::ostream* out, Ts... args)
+    void log(Level level, Ts&&... args)
     {
-        std::stringstream buf;
-        (buf << ... << args);
-        (*out) << buf.str() << std::endl;
+        log_at(0, level, std::forward<Ts>(args)...);
     }
 
-	template<typename... Ts>
-	void info(Ts... args)
-	{
-		print(std_out, "I ", timestamp_nano(), " ", args...);
-	}
+    // without a call site, INFO() and ERR() record theirs
+    template<typename... Ts>
+    void info(Ts&&... args)
+    {
+        log(Level::info, std::forward<Ts>(args)...);
+    }
 
     // TODO likely to be called a lot, prob worth a look into inlining or smth
     template<typename... Ts>
-    void dbg(Ts... args)
+    void dbg(Ts&&... args)
     {
-        print(std_out, "D ", timestamp_nano(), " ", args...);
+        log(Level::dbg, std::forward<Ts>(args)...);
     }
 
     // log into error output (stderr, should be configurable in the future)
     template<typename... Ts>
-    void err(Ts... args)
+    void err(Ts&&... args)
     {
-        print(err_out, "E ", timestamp_nano(), " ", args...);
+        log(Level::err, std::forward<Ts>(args)...);
     }
 
 } // namespace logs
@@ -50,13 +289,28 @@ namespace logs {
     #error SRC_POS already defined
 #endif
 
-#ifdef DEBUG
-    #define DBG(verbocity, ...) if ((DEBUG) >= (verbocity) || (DEBUG) == -1) {\
-    logs::dbg(SRC_POS, " ", __VA_ARGS__);\
-}
+/* arguments are only evaluated if the category's level is high enough, the
+   source position is registered once as a call site instead of being logged
+   with each record */
+#define DBG_CAT(category, verbocity, ...) do {\
+    if (logs::dbg_enabled((category), (verbocity))) {\
+        static const std::uint32_t log_site_ {\
+            logs::register_site(__FILE__, __LINE__, (category))};\
+        logs::log_at(log_site_, logs::Level::dbg, __VA_ARGS__);\
+    }\
+} while (0)
 
-#else
-#   define DBG(verbocity, ...) // nothing to do if not a debug build
-#endif // DEBUG
+#define DBG(verbocity, ...) \
+    DBG_CAT(logs::Category::general, verbocity, __VA_ARGS__)
+
+// info and errors with their call site, registered like DBG_CAT's
+#define LOG_AT_SITE_(level, ...) do {\
+    static const std::uint32_t log_site_ {\
+        logs::register_site(__FILE__, __LINE__, logs::Category::general)};\
+    logs::log_at(log_site_, (level), __VA_ARGS__);\
+} while (0)
+
+#define INFO(...) LOG_AT_SITE_(logs::Level::info, __VA_ARGS__)
+#define ERR(...) LOG_AT_SITE_(logs::Level::err, __VA_ARGS__)
 
 #endif // SRC_LOGS_HPP_
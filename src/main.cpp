@@ -1,7 +1,10 @@
-#include <array>
 #include <chrono>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <sstream>
+#include <string_view>
 #include <thread>
 #include <vector>
 
@@ -10,16 +13,35 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include <ktx.h>
 
+#include "Frame_stats.hpp"
+#include "Gpu_timer.hpp"
 #include "Obj3.hpp"
+#include "Rock.hpp"
+#include "Shader_manager.hpp"
 #include "Ship.hpp"
+#include "Snapshot_ring.hpp"
+#include "alloc_tracker.hpp"
+#include "delta.hpp"
+#include "flight_recorder.hpp"
+#include "gl_stats.hpp"
+#include "hash.hpp"
 #include "logs.hpp"
+#include "net.hpp"
+#include "replay.hpp"
+#include "scenario.hpp"
+#include "server.hpp"
+#include "sim.hpp"
+#include "state_hash.hpp"
+#include "text.hpp"
+#include "textures.hpp"
+#include "trace.hpp"
 #include "utils.hpp"
 #include "version.hpp"
 
-/* TODO consider getting rid of debug-only compilation code, enable debug mode
-   via cmd arg instead */
+extern "C" {
+#include "timestamp.h"
+}
 
 // TODO temporary solution to test out some things
 enum Player_id {
@@ -27,7 +49,38 @@ enum Player_id {
     PID_pl2
 };
 
+// order of uniform names given to the shader manager, same for all programs
+enum Uniform_id {
+    UID_transform = 0,
+    UID_view,
+    UID_projection,
+    UID_color
+};
+
 GLFWwindow* init_window(int w, int h, const std::string& name);
+int run_headless(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    replay::Reader& replay_in,
+    replay::Recorder& recorder,
+    state_hash::Checker& hashes,
+    delta::Probe& deltas,
+    int argc,
+    char** argv);
+int run_headless_net(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    net::Peer& peer,
+    replay::Recorder& recorder,
+    state_hash::Checker& hashes,
+    delta::Probe& deltas);
+int run_headless_client(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    server::Client& client);
 
 int main(int argc, char** argv)
 {
@@ -35,49 +88,184 @@ int main(int argc, char** argv)
     int win_w {1280};
     int win_h {720};
 
-    logs::info("PROGRAM START");
-    logs::info("name: ", program_name, " ", version_str());
+    logs::init(argc, argv);
+    flight::init(argc, argv);
+    trace::init(argc, argv);
+    trace::set_thread_name("main");
+    alloc_tracker::init(argc, argv);
+    scenario::Config scenario;
+    if (!scenario::parse(argc, argv, scenario)) { return -1; }
+    replay::Reader replay_in;
+    if (!replay_in.init(argc, argv)) { return -1; }
+    if (replay_in.active()) { replay_in.apply(scenario); }
+    net::Config net_config;
+    if (!net::parse(argc, argv, net_config)) { return -1; }
+    if (net_config.enabled && replay_in.active()) {
+        ERR("can not replay a networked game, replay it alone");
+        return -1;
+    }
+    server::Config server_config;
+    if (!server::parse(argc, argv, server::Side::client, server_config)) {
+        return -1;
+    }
+    if (!server_config.connect.empty() &&
+        (net_config.enabled || replay_in.active()))
+    {
+        ERR("a client of a server can not replay or have a peer too");
+        return -1;
+    }
+    INFO("PROGRAM START");
+    INFO("name: ", program_name, " ", version_str());
 
 #ifdef DEBUG
     DBG(0, "DEBUG: ", DEBUG);
+#endif //DEBUG
 
-    {
+    if (logs::dbg_enabled(logs::Category::general, 0)) {
         std::stringstream ss;
         for(int i {0}; i < argc; ++i) {
             ss << argv[i];
             if (i + 1 < argc) { ss << " "; }
         }
 
-        logs::info("args (", argc, "): ", ss.str());
+        INFO("args (", argc, "): ", ss.str());
     }
 
-    DBG(0, "GL_MAX_UNIFORM_LOCATIONS: ", GL_MAX_UNIFORM_LOCATIONS);
-#endif //DEBUG
+    DBG_CAT(logs::Category::render, 0,
+            "GL_MAX_UNIFORM_LOCATIONS: ", GL_MAX_UNIFORM_LOCATIONS);
+
+    // camera, also decides the arena size so it's needed even without GL
+    constexpr float fov{glm::radians(60.0f)}; // field of view
+    const float aspect_r{static_cast<float>(win_w) / win_h}; // aspect ratio
+    constexpr float near_clip{0.1f}; // near clipping plane
+    constexpr float far_clip{100.0f}; // far clipping plane
+    DBG_CAT(logs::Category::render, 0,
+            "WxH (AR): ", win_w, "x", win_h, " (", aspect_r, ")");
+    float cam_distance {-40.0f};
+
+    // determine world-space size of screen at distance
+    float view_half_h {std::abs(cam_distance) * std::tan(fov / 2)};
+    float view_half_w {view_half_h * aspect_r};
+    float pixel_size {2 * view_half_w / win_w};
+    DBG(0, "vW/2: ", view_half_w, " vH/2: ", view_half_h, " pix: ", pixel_size);
+
+    Boxf arena_bounds {-view_half_w, -view_half_h,
+                       view_half_w * 2, view_half_h * 2};
+
+    Model3 spaceship_model;
+    spaceship_model.verts = std::vector{
+        -0.65f, -0.65f, 0.0f,
+        0.65f, -0.65f, 0.0f,
+        0.0f,  1.0f, 0.0f};
+
+    // lumpy nonagon of about radius 1, drawn as a line loop
+    Model3 rock_model;
+    rock_model.verts = std::vector{
+        0.0f, 1.0f, 0.0f,
+        0.6f, 0.75f, 0.0f,
+        0.95f, 0.3f, 0.0f,
+        0.85f, -0.35f, 0.0f,
+        0.45f, -0.9f, 0.0f,
+        -0.2f, -0.95f, 0.0f,
+        -0.75f, -0.6f, 0.0f,
+        -1.0f, 0.05f, 0.0f,
+        -0.65f, 0.7f, 0.0f};
+
+    // too big for the stack
+    const auto world_mem {std::make_unique<sim::World>()};
+    sim::World& world {*world_mem};
+    world.arena = arena_bounds;
+    if (replay_in.active()) {
+        world.arena = replay_in.header().arena;
+        world.muzzle_vel = replay_in.header().muzzle_vel;
+    }
+    world.ships.push_back(Ship(
+        &spaceship_model,
+        glm::vec3{-10.0f, 0.0f, 0.0f},
+        glm::vec3{0.0f},
+        glm::vec3{0.0f, 1.0f, 1.0f}));
+    world.ships.push_back(Ship(
+        &spaceship_model,
+        glm::vec3{10.0f, 0.0f, 0.0f},
+        glm::vec3{0.0f},
+        glm::vec3{0.0f, 1.0f, 0.5f}));
+    world.players = world.ships.size();
+    scenario::populate(scenario, world, &spaceship_model, &rock_model);
+
+    constexpr unsigned fps_tgt {60}; // FPS target
+    float dt {1.0f / fps_tgt}; // TODO hardcoded, adapt to actual delta time
+    constexpr std::chrono::milliseconds frame_dur_tgt{1000/fps_tgt};
+    if (replay_in.active()) { dt = replay_in.header().dt; }
+
+    const replay::Header header {replay::make_header(
+        scenario, world.players, world.arena, world.muzzle_vel, dt)};
+    replay::Recorder recorder;
+    recorder.init(argc, argv, header);
+    state_hash::Checker hashes;
+    if (!hashes.init(argc, argv)) { return -1; }
+    delta::Probe deltas;
+    deltas.init(argc, argv);
+
+    // as a client the server steps the world, there is nothing to record
+    server::Client client;
+    if (!server_config.connect.empty()) {
+        if (recorder.active() || hashes.active()) {
+            ERR("a client of a server can not record or hash");
+            return -1;
+        }
+        if (!client.init(server_config)) { return -1; }
+    }
+
+    /* with a peer the world is stepped by rollback, recorded and hashed are
+       only the states confirmed by both sides; the header covers everything
+       both sides have to agree on */
+    net::Peer peer;
+    if (net_config.enabled &&
+        !peer.init(net_config, hash::xxh64(&header, sizeof(header)),
+                   world, dt))
+    {
+        return -1;
+    }
+
+    if (scenario.headless) {
+        const std::uint64_t frames {scenario.frames != 0 ?
+            scenario.frames : scenario::headless_default_frames};
+        const int ret {client.active() ?
+            run_headless_client(world, frames, dt, client) :
+            peer.active() ?
+            run_headless_net(world, frames, dt, peer, recorder, hashes,
+                             deltas) :
+            run_headless(world, frames, dt, replay_in, recorder, hashes,
+                         deltas, argc, argv)};
+        trace::write();
+        alloc_tracker::report();
+        INFO("PROGRAM END");
+        return ret;
+    }
 
     GLFWwindow* window = init_window(win_w, win_h, program_name);
     if (window == nullptr) {
-        logs::err("failed to initialize window");
+        ERR("failed to initialize window");
         return -1;
     }
 
-#ifdef DEBUG
-    {
+    if (logs::dbg_enabled(logs::Category::render, 0)) {
     const char* gl_s = (const char*) glGetString(GL_VERSION);
-    DBG(0, "GL_VERSION: ", gl_s ? gl_s : "(null)");
+    DBG_CAT(logs::Category::render, 0, "GL_VERSION: ", gl_s ? gl_s : "(null)");
 
     GLint gl_i {0};
     glGetIntegerv(GL_NUM_EXTENSIONS, &gl_i);
-    DBG(0, "GL_NUM_EXTENSIONS: ", gl_i);
-    if (DEBUG >= 9) {
-        DBG(9, "GL_EXTENSIONS: vvv");
+    DBG_CAT(logs::Category::render, 0, "GL_NUM_EXTENSIONS: ", gl_i);
+    if (logs::dbg_enabled(logs::Category::render, 9)) {
+        DBG_CAT(logs::Category::render, 9, "GL_EXTENSIONS: vvv");
         for (GLint i {0}; i < gl_i; ++i) {
             gl_s =
                 reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
-            DBG(9, "GL_EXT ", i, ": ", gl_s ? gl_s : "(null)");
+            DBG_CAT(logs::Category::render, 9,
+                    "GL_EXT ", i, ": ", gl_s ? gl_s : "(null)");
         }
     }
     }
-#endif
 
     // Create and set VAO
     GLuint vertex_array_id;
@@ -88,150 +276,43 @@ int main(int argc, char** argv)
     glGenBuffers(1, &vertex_buffer_id);
     glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
 
-    GLuint shader_id =
-        load_shaders("shaders/simple.vert", "shaders/simple.frag");
-    if (shader_id == 0) {
-        logs::err("failed to load shaders");
+    /* all programs are compiled in one go, the driver can work on them while
+       the textures are being loaded, status is only checked once needed */
+    Shader_manager shaders;
+    const std::vector<std::string> uniform_names {
+        "transform", "view", "projection", "color"};
+    const Shader_manager::Program_id prog_simple {shaders.add(
+        "shaders/simple.vert", "shaders/simple.frag", uniform_names)};
+    const Shader_manager::Program_id prog_text {shaders.add(
+        "shaders/simple_tex.vert", "shaders/sdf_text.frag", uniform_names)};
+    if (!shaders.compile_all()) {
+        ERR("failed to load shaders");
+        shaders.shutdown();
         glfwTerminate();
         return -1;
     }
 
-    GLuint shader_id_tex =
-        load_shaders("shaders/simple_tex.vert", "shaders/simple_tex.frag");
-    if (shader_id == 0) {
-        logs::err("failed to load shaders");
+    // signed distance field atlas, one texture for text of any size
+    const GLuint font_texture {
+        load_ktx_texture("gfx/fonts/terminus_8x16_sdf.ktx2")};
+    if (font_texture == 0) {
+        ERR("failed to load font texture");
+        shaders.shutdown();
         glfwTerminate();
         return -1;
     }
 
-    // TEXTURE EXPERIMENT ----------------------------------------
-    GLuint texture;
-	glGenTextures(1, &texture);
-    /* all upcoming GL_TEXTURE_2D operations now have effect on this texture
-       object */
-	glBindTexture(GL_TEXTURE_2D, texture);
-	// set the texture wrapping parameters
-    // set texture wrapping to GL_REPEAT (default wrapping method)
-	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	// set texture filtering parameters
-	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-
-    // KTX2 -- texture loading experiment --------------------------------------
-    ktxTexture2* kTexture;
-    KTX_error_code result;
-
-    result = ktxTexture_CreateFromNamedFile(
-        "gfx/fonts/terminus_8x16.ktx2",
-        // KTX_TEXTURE_CREATE_NO_FLAGS,
-        KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT,
-        (ktxTexture**)&kTexture);
-    if (result != KTX_SUCCESS) {
-        logs::err("KTX create from file failed: ", ktxErrorString(result));
-        return -1;
-    }
-
-    /* TODO - adapt transcode target format based on GPU extensions available,
-       at least differentiate between BC3-7, as desktops are priority now */
-    /* force transcoding to BC7 as it may want to default to ASTC but that's
-       usually only available on mobile cards. */
-    if (ktxTexture2_NeedsTranscoding(kTexture)) {
-        result = ktxTexture2_TranscodeBasis(kTexture, KTX_TTF_BC7_RGBA, 0);
-        if (result != KTX_SUCCESS) {
-            logs::err(
-                "KTX ktxTexture2_TranscodeBasis failed:",
-                ktxErrorString(result));
-            return -1;
-        }
-    }
-    result = ktxLoadOpenGL((PFNGLGETPROCADDRESS)glfwGetProcAddress);
-    if (result != KTX_SUCCESS) {
-        logs::err("KTX LoadOpenGL failed: ", ktxErrorString(result));
-        return -1;
-    }
-
-    GLenum target, glerror;
-    result =
-        ktxTexture_GLUpload((ktxTexture*)kTexture, &texture, &target, &glerror);
-    if (result != KTX_SUCCESS) {
-        logs::err("KTX GLUpload failed: ", ktxErrorString(result));
-        return -1;
-    }
-    ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(kTexture));
-    // END KTX2 -- texture loading experiment ----------------------------------
-
-
-    Model3 square_model;
-    square_model.verts = std::vector{
-        // 3x vert coord, 2x texture coord
-#if 1 /* TODO - remove conditional compile once done with character render POC
-         this should be off if only drawing part of the texture */
-        0.0f, 0.0f, 0.0f, 0.0f, 1.0f,  // bottom left
-        64.0f, 0.0f, 0.0f, 1.0f, 1.0f,  // bottom right
-        0.0f, 208.0f, 0.0f, 0.0f, 0.0f, // top left
-        64.0f, 208.0f, 0.0f, 1.0f, 0.0f, // top right
-#endif
-#if 1 // TODO - remove, part of character render POC via texture offset
-        0.0f, 0.0f, 0.0f,     (1.0f * 2) / 8, (1.0f * 9) / 13,  // bottom left
-        64.0f, 0.0f, 0.0f,    (1.0f * 3) / 8, (1.0f * 9) / 13,  // bottom right
-        0.0f, 208.0f, 0.0f,   (1.0f * 2) / 8, (1.0f * 10) / 13, // top left
-        64.0f, 208.0f, 0.0f,  (1.0f * 3) / 8, (1.0f * 10) / 13, // top right
-#endif
-    };
-
 
     // projection matrix
-    constexpr float fov{glm::radians(60.0f)}; // field of view
-    const float aspect_r{static_cast<float>(win_w) / win_h}; // aspect ratio
-    constexpr float near_clip{0.1f}; // near clipping plane
-    constexpr float far_clip{100.0f}; // far clipping plane
     glm::mat4 proj_mx(glm::perspective(fov, aspect_r, near_clip, far_clip));
-    DBG(0, "WxH (AR): ", win_w, "x", win_h, " (", aspect_r, ")");
 
     // view matrix
-    float cam_distance {-40.0f};
     glm::mat4 view_mx(1.0f);
     view_mx = glm::translate(view_mx, glm::vec3(0.0f, 0.0f, cam_distance));
 
     constexpr glm::vec3 color_debug{1.0f, 0.5f, 0.0f};
     constexpr glm::vec3 color_bullet{1.0f, 1.0f, 1.0f};
-
-    Model3 spaceship_model;
-    spaceship_model.verts = std::vector{
-        -0.65f, -0.65f, 0.0f,
-        0.65f, -0.65f, 0.0f,
-        0.0f,  1.0f, 0.0f};
-
-    std::array<Ship, 2> ships{
-        Ship(
-            &spaceship_model,
-            glm::vec3{-10.0f, 0.0f, 0.0f},
-            glm::vec3{0.0f},
-            glm::vec3{0.0f, 1.0f, 1.0f}),
-        Ship(
-            &spaceship_model,
-            glm::vec3{10.0f, 0.0f, 0.0f},
-            glm::vec3{0.0f},
-            glm::vec3{0.0f, 1.0f, 0.5f})
-    };
-
-    std::vector<Bullet> bullets;
-    float bullet_muz_vel {0.05f};
-
-    // determine world-space size of screen at distance
-    float view_half_h {std::abs(cam_distance) * std::tan(fov / 2)};
-    float view_half_w {view_half_h * aspect_r};
-    float pixel_size {2 * view_half_w / win_w};
-    DBG(0, "vW/2: ", view_half_w, " vH/2: ", view_half_h, " pix: ", pixel_size);
-
-    Boxf arena_bounds {-view_half_w, -view_half_h,
-                       view_half_w * 2, view_half_h * 2};
+    constexpr glm::vec3 color_rock{0.6f, 0.55f, 0.5f};
 
     GLfloat arena_bounds_verts[] {
         arena_bounds.x, arena_bounds.y, 0.0f,
@@ -240,121 +321,165 @@ int main(int argc, char** argv)
         arena_bounds.x, arena_bounds.y + arena_bounds.h, 0.0f,
     };
 
-    constexpr unsigned fps_tgt {60}; // FPS target
-    float dt {1.0f / fps_tgt}; // TODO hardcoded, adapt to actual delta time
-    constexpr std::chrono::milliseconds frame_dur_tgt{1000/fps_tgt};
-    unsigned int trans_loc = glGetUniformLocation(shader_id, "transform");
-    unsigned int view_loc = glGetUniformLocation(shader_id, "view");
-    unsigned int proj_loc = glGetUniformLocation(shader_id, "projection");
-    unsigned int color_loc = glGetUniformLocation(shader_id, "color");
-
-    unsigned int tex_trans_loc =
-        glGetUniformLocation(shader_id_tex, "transform");
-    unsigned int tex_view_loc =
-        glGetUniformLocation(shader_id_tex, "view");
-    unsigned int tex_proj_loc =
-        glGetUniformLocation(shader_id_tex, "projection");
-    unsigned int tex_color_loc =
-        glGetUniformLocation(shader_id_tex, "color");
-
+    // title in the top left corner of the arena
+    std::vector<float> text_verts;
+    const GLsizei title_vert_count = layout_text(
+        program_name + " " + version_str(),
+        arena_bounds.x + 0.5f, arena_bounds.y + arena_bounds.h - 2.0f, 1.5f,
+        text_verts);
+    const std::size_t title_floats {text_verts.size()};
+    // room for the stats overlay, 30 floats per char
+    text_verts.reserve(title_floats + 256 * 30);
+
+    // GL stats of the last frame below the title, F3 toggles
+    bool show_stats {true};
+    bool stats_key_down {false};
+
+    // render passes, "frame" covers all of them
+    Gpu_timer gpu_timer;
+    const Gpu_timer::Pass_id pass_frame {gpu_timer.add("frame")};
+    const Gpu_timer::Pass_id pass_ships {gpu_timer.add("ships")};
+    const Gpu_timer::Pass_id pass_bullets {gpu_timer.add("bullets")};
+    const Gpu_timer::Pass_id pass_rocks {gpu_timer.add("rocks")};
+    const Gpu_timer::Pass_id pass_arena {gpu_timer.add("arena")};
+    const Gpu_timer::Pass_id pass_text {gpu_timer.add("text")};
+
+    // first point the programs are needed, waits for the driver if not done
+    trace::Scope shader_wait {"wait for shaders"};
+    if (shaders.get(prog_simple) == 0 || shaders.get(prog_text) == 0) {
+        ERR("failed to load shaders");
+        shaders.shutdown();
+        gpu_timer.shutdown();
+        glfwTerminate();
+        return -1;
+    }
+    shader_wait.end();
+    // edits to the sources get picked up while running
+    shaders.watch("shaders");
+
+    Frame_stats frame_stats {1000.0 / fps_tgt};
+    frame_stats.init(argc, argv, "frame");
+
+    /* the last two seconds of steps, Backspace rewinds through them a step
+       per frame; not while recording, replaying or hashing as those expect
+       every step once */
+    Snapshot_ring snapshots {2 * fps_tgt};
+    const bool can_rewind {!replay_in.active() && !recorder.active() &&
+        !hashes.active() && !peer.active() && !client.active()};
+    snapshots.save(world);
+
+    std::uint64_t frame {0};
+    std::uint64_t prev_frame_start_ns {0};
     bool should_close {false};
     while (!should_close) {
-        glEnableVertexAttribArray(0);
+        const std::uint64_t frame_start_ns {timestamp_mono_ns()};
+        trace::Scope frame_scope {"frame"};
+
+        /* program handles and uniform locations change when a shader gets
+           reloaded, so they are only valid for the frame */
+        shaders.update();
+        const GLuint shader_id {shaders.get(prog_simple)};
+        const GLint trans_loc {shaders.uniform(prog_simple, UID_transform)};
+        const GLint view_loc {shaders.uniform(prog_simple, UID_view)};
+        const GLint proj_loc {shaders.uniform(prog_simple, UID_projection)};
+        const GLint color_loc {shaders.uniform(prog_simple, UID_color)};
+
+        const GLuint shader_id_text {shaders.get(prog_text)};
+        const GLint text_trans_loc {shaders.uniform(prog_text, UID_transform)};
+        const GLint text_view_loc {shaders.uniform(prog_text, UID_view)};
+        const GLint text_proj_loc {shaders.uniform(prog_text, UID_projection)};
+        const GLint text_color_loc {shaders.uniform(prog_text, UID_color)};
+
+        gl_stats::enable_vertex_attrib_array(0);
 
         glClearColor(0.0f, 0.01f, 0.03f, 0.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        if (glfwGetKey(window, GLFW_KEY_W)) {
-            ships[PID_pl1].vel +=
-                ships[PID_pl1].accel * ships[PID_pl1].front * dt;
-        }
-        if (glfwGetKey(window, GLFW_KEY_A)) {
-            ships[PID_pl1].rot.z += ships[PID_pl1].rot_rate * dt;
-        }
-        if (glfwGetKey(window, GLFW_KEY_D)) {
-            ships[PID_pl1].rot.z -= ships[PID_pl1].rot_rate * dt;
-        }
-        if (glfwGetKey(window, GLFW_KEY_S)) {
-            if (ships[PID_pl1].shot_cooldown_rem <= 0.0f) {
-                // spawn with ship-relative pos so ship-relative rot works well
-                bullets.push_back(Bullet{
-                        ships[PID_pl1].gun_disp,
-                        ships[PID_pl1].vel});
-
-                glm::mat4 trans_mx {1.0f};
-                /* TODO prob. better use Obj3.rot as axis argument containing
-                   fraction of 360deg instead of passing rot and hardcoded
-                   axis, feels more natural data-wise and more efficient if we
-                   later need rotation for more than one axis simultaneously. */
-                trans_mx = glm::rotate(
-                    trans_mx,
-                    glm::radians(ships[PID_pl1].rot.z),
-                    glm::vec3(0.0f, 0.0f, 1.0f));
-                // just because we need vec4 for glm rotation calc, I'm lazy atm
-                glm::vec4 pos_buf {bullets.back().pos, 0.0f};
-                pos_buf = trans_mx * pos_buf;
-                bullets.back().pos.x = pos_buf.x;
-                bullets.back().pos.y = pos_buf.y;
-
-                // move to world-relative pos,no longer care about ship-relative
-                bullets.back().pos += ships[PID_pl1].pos;
-
-                // bullet be propelled towards where the ship (gun) is facing
-                bullets.back().vel.x += bullet_muz_vel * ships[PID_pl1].front.x;
-                bullets.back().vel.y += bullet_muz_vel * ships[PID_pl1].front.y;
-
-                ships[PID_pl1].shot_cooldown_rem +=
-                    ships[PID_pl1].shot_cooldown;
+        trace::Scope input_scope {"input"};
+        // everything the simulation gets from the players goes through here
+        std::uint8_t inputs[replay::max_players] {};
+        // past the recording's end nothing steps, this frame is the last
+        bool replay_over {false};
+        if (replay_in.active()) {
+            if (!replay_in.next(inputs)) {
+                replay_over = true;
+                should_close = true;
             }
+        } else {
+            inputs[PID_pl1] =
+                (glfwGetKey(window, GLFW_KEY_W) ? sim::IB_thrust : 0) |
+                (glfwGetKey(window, GLFW_KEY_A) ? sim::IB_left : 0) |
+                (glfwGetKey(window, GLFW_KEY_D) ? sim::IB_right : 0) |
+                (glfwGetKey(window, GLFW_KEY_S) ? sim::IB_fire : 0);
+            // over the network P1's keys steer our ship, whichever it is
+            inputs[PID_pl2] =
+                (glfwGetKey(window, GLFW_KEY_I) ? sim::IB_thrust : 0) |
+                (glfwGetKey(window, GLFW_KEY_J) ? sim::IB_left : 0) |
+                (glfwGetKey(window, GLFW_KEY_L) ? sim::IB_right : 0);
         }
-        if (glfwGetKey(window, GLFW_KEY_I)) {
-            ships[PID_pl2].vel +=
-                ships[PID_pl2].accel * ships[PID_pl2].front * dt;
-        }
-        if (glfwGetKey(window, GLFW_KEY_J)) {
-            ships[PID_pl2].rot.z += ships[PID_pl2].rot_rate * dt;
+        const bool rewind {
+            can_rewind && glfwGetKey(window, GLFW_KEY_BACKSPACE)};
+        if (!rewind && !replay_over && !peer.active() && !client.active()) {
+            recorder.add(inputs);
+            for (std::size_t i {0}; i < world.players; ++i) {
+                sim::apply_input(world, i, inputs[i], dt);
+            }
         }
-        if (glfwGetKey(window, GLFW_KEY_L)) {
-            ships[PID_pl2].rot.z -= ships[PID_pl2].rot_rate * dt;
+        if (glfwGetKey(window, GLFW_KEY_F3)) {
+            if (!stats_key_down) { show_stats = !show_stats; }
+            stats_key_down = true;
+        } else {
+            stats_key_down = false;
         }
 
-        // update phase
-
-        for (auto& bullet : bullets) {
-            bullet.pos += bullet.vel;
-        }
+        input_scope.end();
 
-        for (auto & ship : ships) {
-            ship.pos += ship.vel;
-
-            if (ship.pos.x < arena_bounds.x) {
-                ship.pos.x += arena_bounds.w;
-            } else if (ship.pos.x > arena_bounds.x + arena_bounds.w) {
-                ship.pos.x -= arena_bounds.w;
-            }
-            if (ship.pos.y < arena_bounds.y) {
-                ship.pos.y += arena_bounds.h;
-            } else if (ship.pos.y > arena_bounds.y + arena_bounds.h) {
-                ship.pos.y -= arena_bounds.h;
+        // update phase
+        trace::Scope update_scope {"update"};
+
+        if (client.active()) {
+            client.send_input(inputs[PID_pl1]);
+            client.update(world, &spaceship_model, &rock_model);
+        } else if (peer.active()) {
+            peer.step(inputs[PID_pl1]);
+            std::uint8_t confirmed[replay::max_players] {};
+            for (const sim::World* state;
+                 (state = peer.next_confirmed(confirmed)) != nullptr;)
+            {
+                recorder.add(confirmed);
+                hashes.after_step(*state);
+                deltas.after_step(*state);
             }
-
-            ship.front.x = -sin(glm::radians(ship.rot.z));
-            ship.front.y = cos(glm::radians(ship.rot.z));
-
-            if (ship.shot_cooldown_rem > 0.0f) {ship.shot_cooldown_rem -= dt;}
+        } else if (replay_over) {
+            // nothing recorded to step with, like run_headless()
+        } else if (rewind) {
+            // stays at the oldest snapshot once there
+            if (world.steps > 0) { snapshots.restore(world.steps - 1, world); }
+        } else {
+            sim::step(world, dt);
+            hashes.after_step(world);
+            deltas.after_step(world);
+            snapshots.save(world);
         }
 
+        update_scope.end();
 
         // drawing phase
+        trace::Scope draw_scope {"draw"};
+        gpu_timer.begin_frame();
+        gpu_timer.begin(pass_frame);
 
         // drawing ships
+        gpu_timer.begin(pass_ships);
 
-        glUseProgram(shader_id);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-        glUniformMatrix4fv(view_loc, 1, GL_FALSE, glm::value_ptr(view_mx));
-        glUniformMatrix4fv(proj_loc, 1, GL_FALSE, glm::value_ptr(proj_mx));
+        gl_stats::use_program(shader_id);
+        gl_stats::polygon_mode(GL_FRONT_AND_BACK, GL_LINE);
+        gl_stats::uniform_matrix_4fv(
+            view_loc, 1, GL_FALSE, glm::value_ptr(view_mx));
+        gl_stats::uniform_matrix_4fv(
+            proj_loc, 1, GL_FALSE, glm::value_ptr(proj_mx));
 
-        for (auto& ship : ships) {
+        for (auto& ship : world.ships) {
             // TODO would it make sense to store the model matrix in class?
             glm::mat4 trans_mx {glm::mat4(1.0f)}; // transformation matrix
             trans_mx = glm::translate(trans_mx, ship.pos);
@@ -364,100 +489,174 @@ int main(int argc, char** argv)
                 glm::vec3(0.0f, 0.0f, 1.0f));
 
 
-            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+            gl_stats::bind_buffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+            gl_stats::vertex_attrib_pointer(
+                0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
             // TODO encapsulate, move, etc (same for other objects)
             // TODO should send the ship model only once, rest are instances
             // drawing the ship
-            glUniform3fv(color_loc, 1, glm::value_ptr(ship.color));
-            glUniformMatrix4fv(
+            gl_stats::uniform_3fv(color_loc, 1, glm::value_ptr(ship.color));
+            gl_stats::uniform_matrix_4fv(
                 trans_loc, 1, GL_FALSE, glm::value_ptr(trans_mx));
-            glBufferData(
+            gl_stats::buffer_data(
                 GL_ARRAY_BUFFER,
                 ship.model->verts.size() * sizeof(ship.model->verts[0]),
                 ship.model->verts.data(),
                 GL_STATIC_DRAW);
-            glDrawArrays(GL_TRIANGLES, 0, ship.model->verts.size() / 3);
+            gl_stats::draw_arrays(
+                GL_TRIANGLES, 0, ship.model->verts.size() / 3);
         }
 
+        gpu_timer.end(pass_ships);
+
         // drawing bullets
+        gpu_timer.begin(pass_bullets);
         {
             // just drawing a point at local origin
             GLfloat verts[] {0.0f, 0.0f, 0.0f};
-            glBufferData(
+            gl_stats::buffer_data(
                 GL_ARRAY_BUFFER,
                 3 * sizeof(verts[0]),
                 verts,
                 GL_STATIC_DRAW);
 
         }
-        for (auto& bullet : bullets) {
+        for (auto& bullet : world.bullets) {
             glm::mat4 trans_mx {glm::mat4(1.0f)}; // transformation matrix
             trans_mx = glm::translate(trans_mx, bullet.pos);
 
-            glUseProgram(shader_id);
-            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+            gl_stats::use_program(shader_id);
+            gl_stats::bind_buffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+            gl_stats::vertex_attrib_pointer(
+                0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
-            glUniform3fv(color_loc, 1, glm::value_ptr(color_bullet));
-            glUniformMatrix4fv(
+            gl_stats::uniform_3fv(color_loc, 1, glm::value_ptr(color_bullet));
+            gl_stats::uniform_matrix_4fv(
                 trans_loc, 1, GL_FALSE, glm::value_ptr(trans_mx));
 
-            glDrawArrays(GL_POINTS, 0, 1);
+            gl_stats::draw_arrays(GL_POINTS, 0, 1);
+        }
+
+        gpu_timer.end(pass_bullets);
+
+        // drawing rocks, all share one model
+        gpu_timer.begin(pass_rocks);
+        gl_stats::buffer_data(
+            GL_ARRAY_BUFFER,
+            rock_model.verts.size() * sizeof(rock_model.verts[0]),
+            rock_model.verts.data(),
+            GL_STATIC_DRAW);
+        gl_stats::uniform_3fv(color_loc, 1, glm::value_ptr(color_rock));
+        for (const auto& rock : world.rocks) {
+            glm::mat4 trans_mx {glm::mat4(1.0f)}; // transformation matrix
+            trans_mx = glm::translate(trans_mx, rock.pos);
+            trans_mx = glm::rotate(
+                trans_mx,
+                glm::radians(rock.rot.z),
+                glm::vec3(0.0f, 0.0f, 1.0f));
+            trans_mx = glm::scale(trans_mx, glm::vec3{rock.radius});
+
+            gl_stats::uniform_matrix_4fv(
+                trans_loc, 1, GL_FALSE, glm::value_ptr(trans_mx));
+            gl_stats::draw_arrays(
+                GL_LINE_LOOP, 0, rock_model.verts.size() / 3);
         }
+        gpu_timer.end(pass_rocks);
 
         // drawing the arena bounds
-        glUniform3fv(color_loc, 1, glm::value_ptr(color_debug));
-        glUniformMatrix4fv(
+        gpu_timer.begin(pass_arena);
+        gl_stats::uniform_3fv(color_loc, 1, glm::value_ptr(color_debug));
+        gl_stats::uniform_matrix_4fv(
             trans_loc, 1, GL_FALSE, glm::value_ptr(glm::mat4{1.0f}));
-        glBufferData(
+        gl_stats::buffer_data(
             GL_ARRAY_BUFFER,
             sizeof(arena_bounds_verts), arena_bounds_verts, GL_STATIC_DRAW);
-        glDrawArrays(
+        gl_stats::draw_arrays(
             GL_LINE_LOOP, 0,
             sizeof(arena_bounds_verts) / sizeof(arena_bounds_verts[0]) / 3);
 
-        glDisableVertexAttribArray(0);
+        gl_stats::disable_vertex_attrib_array(0);
+        gpu_timer.end(pass_arena);
+
+        // drawing text
+        gpu_timer.begin(pass_text);
+        text_verts.resize(title_floats);
+        GLsizei text_vert_count {title_vert_count};
+        if (show_stats) {
+            char stats[256];
+            std::size_t len {gl_stats::format(
+                gl_stats::last_frame(), stats, sizeof(stats))};
+            stats[len++] = '\n';
+            len += gpu_timer.format(stats + len, sizeof(stats) - len);
+            text_vert_count += layout_text(
+                std::string_view{stats, len},
+                arena_bounds.x + 0.5f, arena_bounds.y + arena_bounds.h - 3.5f,
+                1.0f, text_verts);
+        }
 
-        // drawing a test texture
-        glUseProgram(shader_id_tex);
-        glUniformMatrix4fv(tex_view_loc, 1, GL_FALSE, glm::value_ptr(view_mx));
-        glUniformMatrix4fv(tex_proj_loc, 1, GL_FALSE, glm::value_ptr(proj_mx));
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        gl_stats::use_program(shader_id_text);
+        gl_stats::uniform_matrix_4fv(
+            text_view_loc, 1, GL_FALSE, glm::value_ptr(view_mx));
+        gl_stats::uniform_matrix_4fv(
+            text_proj_loc, 1, GL_FALSE, glm::value_ptr(proj_mx));
+        gl_stats::polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+        gl_stats::bind_texture(GL_TEXTURE_2D, font_texture);
+        gl_stats::enable(GL_BLEND);
+        gl_stats::blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
         {
-            glm::vec3 texture_color {.85f, .85f, .85f};
-            glm::mat4 trans_mx {glm::mat4(1.0f)};
-            trans_mx = glm::scale(trans_mx, glm::vec3{0.1f});
-            trans_mx = glm::translate(trans_mx, glm::vec3{0.0f});
-
-            glUniform3fv(tex_color_loc, 1, glm::value_ptr(texture_color));
-            glUniformMatrix4fv(
-                tex_trans_loc, 1, GL_FALSE, glm::value_ptr(trans_mx));
-            glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer_id);
-            glBufferData(
+            glm::vec3 text_color {.85f, .85f, .85f};
+            gl_stats::uniform_3fv(
+                text_color_loc, 1, glm::value_ptr(text_color));
+            gl_stats::uniform_matrix_4fv(
+                text_trans_loc, 1, GL_FALSE, glm::value_ptr(glm::mat4{1.0f}));
+
+            gl_stats::bind_buffer(GL_ARRAY_BUFFER, vertex_buffer_id);
+            gl_stats::buffer_data(
                 GL_ARRAY_BUFFER,
-                square_model.verts.size() * sizeof(square_model.verts[0]),
-                square_model.verts.data(),
+                text_verts.size() * sizeof(text_verts[0]),
+                text_verts.data(),
                 GL_STATIC_DRAW);
 
-            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-                                  5 * sizeof(square_model.verts[0]), nullptr);
-            glEnableVertexAttribArray(0);
+            gl_stats::vertex_attrib_pointer(0, 3, GL_FLOAT, GL_FALSE,
+                                            5 * sizeof(text_verts[0]), nullptr);
+            gl_stats::enable_vertex_attrib_array(0);
 
-            glVertexAttribPointer(
+            gl_stats::vertex_attrib_pointer(
                 1, 2, GL_FLOAT, GL_FALSE,
-                5 * sizeof(square_model.verts[0]),
-                (void*)(3* sizeof(square_model.verts[0])));
-            glEnableVertexAttribArray(1);
+                5 * sizeof(text_verts[0]),
+                (void*)(3* sizeof(text_verts[0])));
+            gl_stats::enable_vertex_attrib_array(1);
+
+            gl_stats::draw_arrays(GL_TRIANGLES, 0, text_vert_count);
 
-            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            gl_stats::disable_vertex_attrib_array(1);
+            gl_stats::disable_vertex_attrib_array(0);
         }
+        gl_stats::disable(GL_BLEND);
+        gpu_timer.end(pass_text);
+        gpu_timer.end(pass_frame);
+        gl_stats::end_frame();
 
-        glfwSwapBuffers(window);
+        if (frame % fps_tgt == 0 &&
+            logs::dbg_enabled(logs::Category::render, 2))
+        {
+            char times[256];
+            const std::size_t len {gpu_timer.format(times, sizeof(times))};
+            DBG_CAT(logs::Category::render, 2, "gpu/cpu ms: ",
+                    std::string_view{times, len});
+        }
+        draw_scope.end();
 
-        glfwPollEvents();
+        {
+            TRACE_SCOPE("swap buffers");
+            glfwSwapBuffers(window);
+        }
+        {
+            TRACE_SCOPE("poll events");
+            glfwPollEvents();
+        }
 
         if (glfwWindowShouldClose(window) != 0 ||
             glfwGetKey(window, GLFW_KEY_ESCAPE))
@@ -465,21 +664,227 @@ int main(int argc, char** argv)
             should_close = true;
         }
 
+        const std::uint64_t work_ns {timestamp_mono_ns() - frame_start_ns};
+        flight::add_frame(flight::Frame_sample{
+            frame++,
+            frame_start_ns,
+            static_cast<std::uint32_t>(work_ns),
+            static_cast<std::uint16_t>(world.ships.size()),
+            static_cast<std::uint16_t>(world.rocks.size()),
+            static_cast<std::uint32_t>(world.bullets.size())});
+        if (prev_frame_start_ns != 0) {
+            // 0 until the timer has its first results
+            const std::uint64_t gpu_ns {gpu_timer.times(pass_frame).gpu_ns};
+            frame_stats.add(Frame_stats::Sample{
+                (frame_start_ns - prev_frame_start_ns) / 1e6,
+                work_ns / 1e6,
+                gpu_ns != 0 ? gpu_ns / 1e6 : Frame_stats::no_gpu});
+        }
+        prev_frame_start_ns = frame_start_ns;
+        if (scenario.frames != 0 && frame >= scenario.frames) {
+            should_close = true;
+        }
+
+        frame_scope.end();
+        alloc_tracker::end_frame();
+
+        TRACE_SCOPE("sleep");
         std::this_thread::sleep_for(frame_dur_tgt); // TODO sleep remainder only
     }
 
+    frame_stats.report();
+    deltas.report();
+    if (peer.active()) {
+        peer.linger(world.steps, 1000);
+        peer.report();
+    }
+    if (client.active()) {
+        client.leave();
+        client.report();
+    }
+    // GL objects go before the context does
+    shaders.shutdown();
+    gpu_timer.shutdown();
     glfwTerminate();
-    logs::info("PROGRAM END");
+    trace::write();
+    alloc_tracker::report();
+    INFO("PROGRAM END");
 
     return 0;
 }
 
+// steps the simulation as fast as it goes, no window or GL
+int run_headless(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    replay::Reader& replay_in,
+    replay::Recorder& recorder,
+    state_hash::Checker& hashes,
+    delta::Probe& deltas,
+    int argc,
+    char** argv)
+{
+    INFO("running headless for ", frames, " frames");
+    // as fast as it goes, nothing to pace to
+    Frame_stats frame_stats {Frame_stats::unpaced};
+    frame_stats.init(argc, argv, "headless_frame");
+
+    const std::uint64_t start_ns {timestamp_mono_ns()};
+    std::uint64_t prev_frame_start_ns {0};
+    for (std::uint64_t frame {0}; frame < frames; ++frame) {
+        const std::uint64_t frame_start_ns {timestamp_mono_ns()};
+        // players idle unless replaying
+        std::uint8_t inputs[replay::max_players] {};
+        if (replay_in.active() && !replay_in.next(inputs)) { break; }
+        recorder.add(inputs);
+        {
+            TRACE_SCOPE("update");
+            for (std::size_t i {0}; i < world.players; ++i) {
+                sim::apply_input(world, i, inputs[i], dt);
+            }
+            sim::step(world, dt);
+        }
+        hashes.after_step(world);
+        deltas.after_step(world);
+
+        const std::uint64_t work_ns {timestamp_mono_ns() - frame_start_ns};
+        flight::add_frame(flight::Frame_sample{
+            frame,
+            frame_start_ns,
+            static_cast<std::uint32_t>(work_ns),
+            static_cast<std::uint16_t>(world.ships.size()),
+            static_cast<std::uint16_t>(world.rocks.size()),
+            static_cast<std::uint32_t>(world.bullets.size())});
+        if (prev_frame_start_ns != 0) {
+            frame_stats.add(Frame_stats::Sample{
+                (frame_start_ns - prev_frame_start_ns) / 1e6,
+                work_ns / 1e6,
+                Frame_stats::no_gpu});
+        }
+        prev_frame_start_ns = frame_start_ns;
+        alloc_tracker::end_frame();
+    }
+
+    const double took_ms {(timestamp_mono_ns() - start_ns) / 1e6};
+    INFO("headless: ", frames, " frames in ", took_ms, " ms (",
+         took_ms > 0.0 ? frames * 1000.0 / took_ms : 0.0,
+         " frames/s), ", world.bullets.size(), " bullets in flight, ",
+         world.rock_hits, " rocks hit");
+    frame_stats.report();
+    deltas.report();
+
+    return hashes.diverged() || deltas.failed() ? 1 : 0;
+}
+
+/* one side of a networked game without a window: scripted input at the frame
+   rate until 'frames' frames are confirmed by both sides */
+int run_headless_net(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    net::Peer& peer,
+    replay::Recorder& recorder,
+    state_hash::Checker& hashes,
+    delta::Probe& deltas)
+{
+    INFO("running headless over the network for ", frames, " frames");
+    constexpr double give_up_s {10.0};
+    const std::uint64_t frame_ns {
+        static_cast<std::uint64_t>(dt * 1e9)};
+
+    int ret {0};
+    std::uint64_t confirmed {0};
+    std::uint64_t next_frame_ns {timestamp_mono_ns()};
+    for (std::uint64_t tick {0}; confirmed < frames; ++tick) {
+        peer.step(net::scripted_input(tick, peer.player()));
+        std::uint8_t inputs[replay::max_players] {};
+        for (const sim::World* state;
+             confirmed < frames &&
+                 (state = peer.next_confirmed(inputs)) != nullptr;
+             ++confirmed)
+        {
+            recorder.add(inputs);
+            hashes.after_step(*state);
+            deltas.after_step(*state);
+        }
+        if (peer.idle_s() > give_up_s) {
+            ERR("net: nothing from the other side for ", give_up_s,
+                " s, giving up");
+            ret = 1;
+            break;
+        }
+        alloc_tracker::end_frame();
+
+        // paced like the windowed game, the other side runs at that rate
+        next_frame_ns += frame_ns;
+        const std::uint64_t now_ns {timestamp_mono_ns()};
+        if (next_frame_ns > now_ns) {
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds{next_frame_ns - now_ns});
+        }
+    }
+
+    peer.linger(confirmed, 2000);
+    INFO("headless: ", confirmed, " frames confirmed, ",
+         world.bullets.size(), " bullets in flight, ",
+         world.rock_hits, " rocks hit");
+    peer.report();
+    deltas.report();
+
+    return ret != 0 || hashes.diverged() || deltas.failed() ? 1 : 0;
+}
+
+/* a client of a server without a window: scripted input at the frame rate
+   until 'frames' snapshots arrived */
+int run_headless_client(
+    sim::World& world,
+    std::uint64_t frames,
+    float dt,
+    server::Client& client)
+{
+    INFO("running headless against a server for ", frames,
+         " snapshots");
+    constexpr double give_up_s {10.0};
+    const std::uint64_t frame_ns {
+        static_cast<std::uint64_t>(dt * 1e9)};
+
+    int ret {0};
+    std::uint64_t next_frame_ns {timestamp_mono_ns()};
+    for (std::uint64_t tick {0}; client.snapshots() < frames; ++tick) {
+        client.send_input(net::scripted_input(tick, client.player()));
+        client.update(world, nullptr, nullptr);
+        if (client.idle_s() > give_up_s) {
+            ERR("client: nothing from the server for ", give_up_s,
+                " s, giving up");
+            ret = 1;
+            break;
+        }
+        alloc_tracker::end_frame();
+
+        next_frame_ns += frame_ns;
+        const std::uint64_t now_ns {timestamp_mono_ns()};
+        if (next_frame_ns > now_ns) {
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds{next_frame_ns - now_ns});
+        }
+    }
+
+    INFO("headless: ", client.snapshots(), " snapshots, at step ",
+         world.steps, ", ", world.bullets.size(), " bullets in flight, ",
+         world.rock_hits, " rocks hit");
+    client.leave();
+    client.report();
+
+    return ret;
+}
+
 GLFWwindow* init_window(int w, int h, const std::string& name)
 {
     GLFWwindow* window {nullptr};
 
     if (!glfwInit()) {
-        logs::err("failed to init GLFW");
+        ERR("failed to init GLFW");
         return window;
     }
 
@@ -494,7 +899,7 @@ GLFWwindow* init_window(int w, int h, const std::string& name)
 
     window = glfwCreateWindow(w, h, name.c_str(), nullptr, nullptr);
     if (window == nullptr) {
-        logs::err("failed to create GLFW window");
+        ERR("failed to create GLFW window");
         glfwTerminate();
         return window;
     }
@@ -502,7 +907,7 @@ GLFWwindow* init_window(int w, int h, const std::string& name)
     glfwMakeContextCurrent(window);
     glewExperimental = true;
     if (glewInit() != GLEW_OK) {
-        logs::err("failed to init GLEW");
+        ERR("failed to init GLEW");
         glfwTerminate();
         return window;
     }
@@ -0,0 +1,356 @@
+#include "net.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "Rollback.hpp"
+#include "hash.hpp"
+#include "logs.hpp"
+#include "sim.hpp"
+#include "trace.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+constexpr char packet_magic[4] {'R', 'N', 'B', 'N'};
+
+// followed by 'count' bytes of input for frames 'first' onward
+struct Packet_header final {
+    char magic[4];
+    std::uint32_t session;
+    std::uint32_t ack; // frames of the receiver's input the sender has
+    std::uint32_t first;
+    std::uint8_t player; // whose input
+    std::uint8_t count;
+    std::uint8_t pad[2];
+};
+
+constexpr std::size_t max_inputs {net::max_packet - sizeof(Packet_header)};
+
+bool parse_number(std::string_view str, unsigned long& out)
+{
+    if (str.empty()) { return false; }
+    const std::string s {str};
+    char* end {nullptr};
+    errno = 0;
+    out = std::strtoul(s.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+bool parse_float(std::string_view str, float& out)
+{
+    if (str.empty()) { return false; }
+    const std::string s {str};
+    char* end {nullptr};
+    errno = 0;
+    out = std::strtof(s.c_str(), &end);
+    return errno == 0 && *end == '\0' && out >= 0.0f;
+}
+} // namespace
+
+namespace net {
+    bool parse(int argc, char** argv, Config& config)
+    {
+        for (int i {1}; i + 1 < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            if (arg.substr(0, 6) != "--net-") { continue; }
+
+            const std::string_view value {argv[++i]};
+            unsigned long n {0};
+            bool ok {true};
+            if (arg == "--net-port") {
+                ok = parse_number(value, n) && n > 0 && n <= 65535;
+                config.port = static_cast<std::uint16_t>(n);
+            } else if (arg == "--net-peer") {
+                config.peer = value;
+                ok = value.rfind(':') != std::string_view::npos;
+            } else if (arg == "--net-player") {
+                ok = parse_number(value, n) && n <= 1;
+                config.player = static_cast<std::uint32_t>(n);
+            } else if (arg == "--net-delay") {
+                ok = parse_number(value, n) && n < Rollback::max_prediction;
+                config.delay = static_cast<std::uint32_t>(n);
+            } else if (arg == "--net-latency") {
+                ok = parse_float(value, config.latency_ms);
+            } else if (arg == "--net-jitter") {
+                ok = parse_float(value, config.jitter_ms);
+            } else if (arg == "--net-loss") {
+                ok = parse_float(value, config.loss) && config.loss <= 100.0f;
+            } else {
+                ERR("unknown option ", arg);
+                return false;
+            }
+            if (!ok) {
+                ERR("bad value for ", arg, ": ", value);
+                return false;
+            }
+        }
+
+        config.enabled = config.port != 0 && !config.peer.empty();
+        if (!config.enabled && (config.port != 0 || !config.peer.empty())) {
+            ERR("networked play needs both --net-port and --net-peer");
+            return false;
+        }
+        return true;
+    }
+
+    Link::~Link()
+    {
+        if (fd != -1) { close(fd); }
+    }
+
+    bool Link::open(const Config& config)
+    {
+        const std::size_t colon {config.peer.rfind(':')};
+        const std::string host {config.peer.substr(0, colon)};
+        const std::string port {config.peer.substr(colon + 1)};
+        addrinfo hints {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* found {nullptr};
+        const int gai {
+            getaddrinfo(host.c_str(), port.c_str(), &hints, &found)};
+        if (gai != 0) {
+            ERR("can not resolve ", config.peer, ": ", gai_strerror(gai));
+            return false;
+        }
+        std::memcpy(&peer_addr, found->ai_addr, sizeof(peer_addr));
+        freeaddrinfo(found);
+
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            ERR("can not create socket: ", std::strerror(errno));
+            return false;
+        }
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(config.port);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ERR("can not listen on port ", config.port, ": ",
+                std::strerror(errno));
+            return false;
+        }
+
+        latency_ms = config.latency_ms;
+        jitter_ms = config.jitter_ms;
+        loss = config.loss;
+        rng.reseed(config.player + 1);
+        pending.reserve(256);
+        if (latency_ms > 0.0f || jitter_ms > 0.0f || loss > 0.0f) {
+            INFO("net: sending with ", latency_ms, " +- ", jitter_ms,
+                 " ms latency and ", loss, "% loss");
+        }
+        return true;
+    }
+
+    void Link::send(const void* data, std::size_t size)
+    {
+        send_due();
+        if (loss > 0.0f && rng.chance(loss / 100.0f)) { return; }
+
+        const float delay_ms {std::max(
+            0.0f, latency_ms + rng.uniform(-jitter_ms, jitter_ms))};
+        if (delay_ms == 0.0f) {
+            send_now(data, size);
+            return;
+        }
+        Pending packet {};
+        packet.due_ns = timestamp_mono_ns() +
+            static_cast<std::uint64_t>(delay_ms * 1e6f);
+        packet.size = std::min(size, max_packet);
+        std::memcpy(packet.data.data(), data, packet.size);
+        pending.push_back(packet);
+    }
+
+    std::size_t Link::receive(void* data)
+    {
+        send_due();
+        const ssize_t got {recv(fd, data, max_packet, 0)};
+        if (got < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                errno != ECONNREFUSED)
+            {
+                ERR("net: receive failed: ", std::strerror(errno));
+            }
+            return 0;
+        }
+        return static_cast<std::size_t>(got);
+    }
+
+    void Link::send_now(const void* data, std::size_t size)
+    {
+        const ssize_t sent {sendto(
+            fd, data, size, 0,
+            reinterpret_cast<const sockaddr*>(&peer_addr),
+            sizeof(peer_addr))};
+        // nobody listening yet is fine, the input is sent again
+        if (sent < 0 && errno != ECONNREFUSED && errno != EAGAIN) {
+            DBG_CAT(logs::Category::net, 1, "send failed: ",
+                    std::strerror(errno));
+        }
+    }
+
+    void Link::send_due()
+    {
+        if (pending.empty()) { return; }
+        const std::uint64_t now {timestamp_mono_ns()};
+        // in the order they are due, so jitter reorders them
+        auto due {std::partition(
+            pending.begin(), pending.end(),
+            [now](const Pending& p) { return p.due_ns > now; })};
+        std::sort(due, pending.end(), [](const Pending& a, const Pending& b) {
+            return a.due_ns < b.due_ns;
+        });
+        for (auto it {due}; it != pending.end(); ++it) {
+            send_now(it->data.data(), it->size);
+        }
+        pending.erase(due, pending.end());
+    }
+
+    bool Peer::init(
+        const Config& config,
+        std::uint64_t session,
+        sim::World& world,
+        float dt)
+    {
+        if (!link.open(config)) { return false; }
+
+        rollback = std::make_unique<Rollback>(world, dt);
+        this->session = static_cast<std::uint32_t>(session);
+        local = config.player;
+        remote = 1 - config.player;
+        // the frames before the delay has passed are without input
+        next_local = world.steps;
+        for (std::uint32_t i {0}; i < config.delay; ++i) {
+            rollback->set_input(local, next_local, 0);
+            sent[next_local++ % sent.size()] = 0;
+        }
+        acked = world.steps;
+        last_receive_ns = timestamp_mono_ns();
+        INFO("net: player ", local, " on port ", config.port,
+             ", peer ", config.peer, ", input delay ", config.delay,
+             " frames");
+        return true;
+    }
+
+    bool Peer::step(std::uint8_t input)
+    {
+        TRACE_SCOPE("net");
+        receive();
+        // our input only goes in for frames that are simulated now
+        if (rollback->can_advance()) {
+            rollback->set_input(local, next_local, input);
+            sent[next_local++ % sent.size()] = input;
+        }
+        const bool advanced {rollback->advance()};
+        send();
+        return advanced;
+    }
+
+    void Peer::linger(std::uint64_t frames, unsigned timeout_ms)
+    {
+        const std::uint64_t end_ns {
+            timestamp_mono_ns() + timeout_ms * 1000000ULL};
+        while (acked < frames && timestamp_mono_ns() < end_ns) {
+            receive();
+            send();
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+        }
+    }
+
+    double Peer::idle_s() const
+    {
+        return (timestamp_mono_ns() - last_receive_ns) / 1e9;
+    }
+
+    void Peer::report() const
+    {
+        INFO("net: ", packets_sent, " packets sent, ",
+             packets_received, " received, ", packets_ignored,
+             " ignored");
+        rollback->report();
+    }
+
+    void Peer::receive()
+    {
+        std::uint8_t data[max_packet];
+        for (std::size_t size; (size = link.receive(data)) != 0;) {
+            Packet_header head;
+            if (size < sizeof(head)) {
+                ++packets_ignored;
+                continue;
+            }
+            std::memcpy(&head, data, sizeof(head));
+            if (std::memcmp(head.magic, packet_magic, sizeof(packet_magic)) ||
+                head.session != session || head.player != remote ||
+                sizeof(head) + head.count > size)
+            {
+                if (packets_ignored++ == 0) {
+                    ERR("net: ignoring packets of another game, check "
+                        "both sides run the same build and scenario");
+                }
+                continue;
+            }
+
+            ++packets_received;
+            last_receive_ns = timestamp_mono_ns();
+            acked = std::max<std::uint64_t>(acked, head.ack);
+            for (std::uint8_t i {0}; i < head.count; ++i) {
+                rollback->set_input(
+                    remote, std::uint64_t{head.first} + i,
+                    data[sizeof(head) + i]);
+            }
+        }
+    }
+
+    void Peer::send()
+    {
+        std::uint8_t data[max_packet];
+        Packet_header head {};
+        std::memcpy(head.magic, packet_magic, sizeof(packet_magic));
+        head.session = session;
+        head.ack = static_cast<std::uint32_t>(rollback->confirmed(remote));
+        head.player = static_cast<std::uint8_t>(local);
+        // everything not acknowledged yet, oldest first
+        const std::uint64_t kept_from {
+            next_local > sent.size() ? next_local - sent.size() : 0};
+        const std::uint64_t first {std::max(acked, kept_from)};
+        head.first = static_cast<std::uint32_t>(first);
+        head.count = static_cast<std::uint8_t>(
+            std::min<std::uint64_t>(next_local - first, max_inputs));
+        std::memcpy(data, &head, sizeof(head));
+        for (std::uint8_t i {0}; i < head.count; ++i) {
+            data[sizeof(head) + i] = sent[(first + i) % sent.size()];
+        }
+
+        link.send(data, sizeof(head) + head.count);
+        ++packets_sent;
+    }
+
+    std::uint8_t scripted_input(std::uint64_t frame, std::uint32_t player)
+    {
+        // a new random combination every 20 frames
+        const std::uint64_t key[] {frame / 20, player};
+        const std::uint64_t h {hash::xxh64(key, sizeof(key))};
+        return static_cast<std::uint8_t>(
+            h & (sim::IB_thrust | sim::IB_left | sim::IB_right | sim::IB_fire));
+    }
+} // namespace net
@@ -0,0 +1,152 @@
+#ifndef SRC_NET_HPP_
+#define SRC_NET_HPP_
+
+/*******************************************************************************
+ * Peer to peer rollback networking for the two player game.
+ *
+ * Each side sends its own player's input to the other over UDP, every frame,
+ * repeating whatever the other hasn't acknowledged yet so lost packets don't
+ * matter. Rollback (see Rollback.hpp) runs the world ahead on predicted input
+ * and corrects it when the real input arrives. Both sides have to run the same
+ * build and scenario, packets of a different one are ignored.
+ *
+ *   --net-port <port>       UDP port to listen on
+ *   --net-peer <host:port>  where the other side listens
+ *   --net-player <0|1>      which ship is ours, the other side takes the other
+ *   --net-delay <frames>    local input delay, fewer rollbacks (default 2)
+ *
+ * For testing on one machine, sent packets can be held back and dropped:
+ *
+ *   --net-latency <ms>      added to every packet
+ *   --net-jitter <ms>       plus or minus up to this, reorders packets
+ *   --net-loss <percent>    dropped
+ *
+ * dev/net_loopback.sh runs two headless peers that way and checks they agree.
+ * Packets are in the byte order of the machine, like replays.
+ ******************************************************************************/
+
+#include <netinet/in.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Rng.hpp"
+#include "Rollback.hpp"
+#include "sim.hpp"
+
+namespace net {
+    struct Config final {
+        bool enabled {false}; // both port and peer given
+        std::uint16_t port {0};
+        std::string peer;
+        std::uint32_t player {0};
+        std::uint32_t delay {2};
+        float latency_ms {0.0f};
+        float jitter_ms {0.0f};
+        float loss {0.0f}; // percent
+    };
+
+    // reads the options, false if one is malformed
+    bool parse(int argc, char** argv, Config& config);
+
+    // largest packet sent, header and input
+    constexpr std::size_t max_packet {64};
+
+    // a UDP socket talking to one peer, optionally over a bad link
+    class Link final {
+    public:
+        Link() = default;
+        ~Link();
+
+        Link(const Link&) = delete;
+        Link& operator=(const Link&) = delete;
+
+        bool open(const Config& config);
+
+        // sends now, later or never depending on the impairment
+        void send(const void* data, std::size_t size);
+
+        /* the next packet received into 'data' (max_packet bytes), 0 when
+           there is none */
+        std::size_t receive(void* data);
+
+    private:
+        struct Pending final {
+            std::uint64_t due_ns;
+            std::size_t size;
+            std::array<std::uint8_t, max_packet> data;
+        };
+
+        void send_now(const void* data, std::size_t size);
+        void send_due();
+
+        int fd {-1};
+        sockaddr_in peer_addr {};
+        float latency_ms {0.0f};
+        float jitter_ms {0.0f};
+        float loss {0.0f};
+        Rng rng;
+        std::vector<Pending> pending;
+    };
+
+    class Peer final {
+    public:
+        /* starts listening and takes over stepping 'world', false if the
+           socket can't be set up; 'session' has to be the same on both
+           sides */
+        bool init(
+            const Config& config,
+            std::uint64_t session,
+            sim::World& world,
+            float dt);
+
+        bool active() const { return rollback != nullptr; }
+        std::uint32_t player() const { return local; }
+
+        /* exchanges input with the other side and advances the world a frame
+           with 'input' for our player (after the input delay), false if it
+           had to wait for the other side instead */
+        bool step(std::uint8_t input);
+
+        // see Rollback::next_confirmed()
+        const sim::World* next_confirmed(std::uint8_t* inputs)
+        {
+            return rollback->next_confirmed(inputs);
+        }
+
+        /* before quitting: keeps sending until the other side has our input
+           for 'frames' frames or 'timeout_ms' passed */
+        void linger(std::uint64_t frames, unsigned timeout_ms);
+
+        // seconds since the last packet from the other side
+        double idle_s() const;
+
+        void report() const;
+
+    private:
+        void receive();
+        void send();
+
+        Link link;
+        std::unique_ptr<Rollback> rollback;
+        std::uint32_t session {0};
+        std::uint32_t local {0};
+        std::uint32_t remote {1};
+        std::uint64_t next_local {0}; // frame our next input is for
+        std::uint64_t acked {0}; // frames of our input the other side has
+        std::array<std::uint8_t, Rollback::history> sent {}; // by frame
+        std::uint64_t last_receive_ns {0};
+        std::uint64_t packets_sent {0};
+        std::uint64_t packets_received {0};
+        std::uint64_t packets_ignored {0};
+    };
+
+    // input that changes every few frames, for headless peers
+    std::uint8_t scripted_input(std::uint64_t frame, std::uint32_t player);
+} // namespace net
+
+#endif // SRC_NET_HPP_
@@ -0,0 +1,162 @@
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logs.hpp"
+#include "scenario.hpp"
+#include "utils.hpp"
+#include "version.hpp"
+
+namespace {
+// flushed now and then so a crash doesn't take the last seconds with it
+constexpr std::uint64_t flush_interval {60};
+
+const char* arg_value(
+    int argc,
+    char** argv,
+    std::string_view flag,
+    const char* env)
+{
+    const char* value {env != nullptr ? std::getenv(env) : nullptr};
+    for (int i {1}; i < argc; ++i) {
+        if (std::string_view{argv[i]} == flag && i + 1 < argc) {
+            value = argv[++i];
+        }
+    }
+    return value;
+}
+} // namespace
+
+namespace replay {
+    Recorder::~Recorder()
+    {
+        if (file == nullptr) { return; }
+        std::fclose(file);
+        INFO("recorded ", frames, " frames of input");
+    }
+
+    void Recorder::init(int argc, char** argv, const Header& header)
+    {
+        const char* path {arg_value(argc, argv, "--record", "RNB_RECORD")};
+        if (path == nullptr) { return; }
+
+        file = std::fopen(path, "wb");
+        if (file == nullptr) {
+            ERR("can not open recording ", path, ": ",
+                std::strerror(errno));
+            return;
+        }
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            ERR("can not write recording ", path);
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+        players = header.players;
+        INFO("recording input to ", path);
+    }
+
+    void Recorder::add(const std::uint8_t* inputs)
+    {
+        if (file == nullptr) { return; }
+
+        if (std::fwrite(inputs, 1, players, file) != players) {
+            ERR("can not write recording, stopped: ",
+                std::strerror(errno));
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+        if (++frames % flush_interval == 0) { std::fflush(file); }
+    }
+
+    bool Reader::init(int argc, char** argv)
+    {
+        const char* path {arg_value(argc, argv, "--replay", nullptr)};
+        if (path == nullptr) { return true; }
+
+        std::ifstream in {path, std::ios::binary};
+        if (!in) {
+            ERR("can not open replay ", path, ": ",
+                std::strerror(errno));
+            return false;
+        }
+        if (!in.read(reinterpret_cast<char*>(&head), sizeof(head)) ||
+            std::memcmp(head.magic, magic, sizeof(magic)) != 0)
+        {
+            ERR(path, " is not a replay");
+            return false;
+        }
+        if (head.players == 0 || head.players > max_players) {
+            ERR("bad replay ", path, ": ", head.players, " players");
+            return false;
+        }
+        inputs.assign(std::istreambuf_iterator<char>{in},
+                      std::istreambuf_iterator<char>{});
+        frame_count = inputs.size() / head.players;
+
+        head.version[sizeof(head.version) - 1] = '\0';
+        if (version_str().compare(0, sizeof(head.version) - 1,
+                                  head.version) != 0)
+        {
+            ERR("replay recorded by ", head.version,
+                ", it may play out differently with this build");
+        }
+        loaded = true;
+        INFO("replaying ", frame_count, " frames from ", path);
+
+        return true;
+    }
+
+    void Reader::apply(scenario::Config& config) const
+    {
+        config.ai_ships = head.ai_ships;
+        config.rocks = head.rocks;
+        config.fire_rate = head.fire_rate;
+        config.seed = head.seed;
+        config.frames = config.frames != 0 ?
+            std::min<std::uint64_t>(config.frames, frame_count) : frame_count;
+    }
+
+    bool Reader::next(std::uint8_t* out)
+    {
+        if (frame == frame_count) { return false; }
+        std::copy_n(&inputs[frame * head.players], head.players, out);
+        ++frame;
+        return true;
+    }
+
+    Header make_header(
+        const scenario::Config& config,
+        std::size_t players,
+        const Boxf& arena,
+        float muzzle_vel,
+        float dt)
+    {
+        Header header {};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        const std::string version {version_str()};
+        version.copy(header.version, sizeof(header.version) - 1);
+        header.players = static_cast<std::uint32_t>(players);
+        header.ai_ships = config.ai_ships;
+        header.rocks = config.rocks;
+        header.fire_rate = config.fire_rate;
+        header.seed = config.seed;
+        header.arena = arena;
+        header.muzzle_vel = muzzle_vel;
+        header.dt = dt;
+
+        return header;
+    }
+} // namespace replay
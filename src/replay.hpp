@@ -0,0 +1,100 @@
+#ifndef SRC_REPLAY_HPP_
+#define SRC_REPLAY_HPP_
+
+/*******************************************************************************
+ * Input recording and replay.
+ *
+ * With --record <file> (or RNB_RECORD) every frame's player input goes to the
+ * file, one byte of sim::Input_bit per player per step, after a header with
+ * everything else the run depends on: the scenario (seed included), the arena,
+ * the time step and the build. --replay <file> feeds the input back through
+ * the same update code instead of reading the keyboard, so a session plays
+ * out exactly as it did, windowed or with --headless at full speed. It ends
+ * when the input does.
+ *
+ * Replays are only exact with the build that recorded them (floating point
+ * results may differ otherwise), a different build is warned about. Files are
+ * in the byte order of the machine that wrote them.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "scenario.hpp"
+#include "utils.hpp"
+
+namespace replay {
+    constexpr char magic[8] {'R', 'N', 'B', 'R', 'P', 'L', '0', '1'};
+    constexpr std::size_t max_players {8};
+
+    struct Header final {
+        char magic[8];
+        char version[48]; // version_str() of the build, cut to fit
+        std::uint32_t players;
+        std::uint32_t ai_ships;
+        std::uint32_t rocks;
+        float fire_rate;
+        std::uint64_t seed;
+        Boxf arena;
+        float muzzle_vel;
+        float dt;
+    };
+
+    class Recorder final {
+    public:
+        Recorder() = default;
+        ~Recorder();
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        // starts recording if asked for on the command line or environment
+        void init(int argc, char** argv, const Header& header);
+
+        // one step's input, header.players bytes
+        void add(const std::uint8_t* inputs);
+
+        bool active() const { return file != nullptr; }
+
+    private:
+        std::FILE* file {nullptr};
+        std::size_t players {0};
+        std::uint64_t frames {0};
+    };
+
+    class Reader final {
+    public:
+        /* loads the replay asked for on the command line, false if it can't,
+           true if none was asked for */
+        bool init(int argc, char** argv);
+
+        bool active() const { return loaded; }
+        const Header& header() const { return head; }
+        std::uint64_t frames() const { return frame_count; }
+
+        // runs the recorded scenario instead
+        void apply(scenario::Config& config) const;
+
+        // the next step's input, false once all have been played
+        bool next(std::uint8_t* inputs);
+
+    private:
+        bool loaded {false};
+        Header head {};
+        std::vector<std::uint8_t> inputs;
+        std::uint64_t frame_count {0};
+        std::uint64_t frame {0};
+    };
+
+    // the header to record a world populated from 'config' with
+    Header make_header(
+        const scenario::Config& config,
+        std::size_t players,
+        const Boxf& arena,
+        float muzzle_vel,
+        float dt);
+} // namespace replay
+
+#endif // SRC_REPLAY_HPP_
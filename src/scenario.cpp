@@ -0,0 +1,220 @@
+#include "scenario.hpp"
+
+#include <cerrno>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include <glm/glm.hpp>
+
+#include "Ship.hpp"
+#include "logs.hpp"
+
+namespace {
+// options that take a value and the setting they are
+struct Option {
+    std::string_view flag;
+    std::string_view name;
+};
+
+constexpr Option options[] {
+    {"--ai-ships", "ai_ships"},
+    {"--rocks", "rocks"},
+    {"--fire-rate", "fire_rate"},
+    {"--seed", "seed"},
+    {"--frames", "frames"},
+};
+
+bool parse_uint(const std::string& str, std::uint64_t& out)
+{
+    if (str.empty() || str[0] == '-') { return false; }
+    char* end;
+    errno = 0;
+    out = std::strtoull(str.c_str(), &end, 0);
+    return errno == 0 && *end == '\0';
+}
+
+bool set(
+    scenario::Config& config,
+    std::string_view name,
+    const std::string& value)
+{
+    std::uint64_t n {0};
+    if (name == "fire_rate") {
+        char* end;
+        config.fire_rate = std::strtof(value.c_str(), &end);
+        return !value.empty() && *end == '\0' &&
+            std::isfinite(config.fire_rate) && config.fire_rate >= 0.0f;
+    }
+    if (!parse_uint(value, n)) { return false; }
+
+    if (name == "ai_ships" || name == "rocks") {
+        if (n > std::numeric_limits<std::uint32_t>::max()) { return false; }
+        (name == "rocks" ? config.rocks : config.ai_ships) =
+            static_cast<unsigned>(n);
+    } else if (name == "seed") {
+        config.seed = n;
+    } else if (name == "frames") {
+        config.frames = n;
+    } else if (name == "headless") {
+        config.headless = n != 0;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+} // namespace
+
+namespace scenario {
+    bool parse(int argc, char** argv, Config& config)
+    {
+        const char* path {std::getenv("RNB_SCENARIO")};
+        for (int i {1}; i < argc; ++i) {
+            if (std::string_view{argv[i]} == "--scenario" && i + 1 < argc) {
+                path = argv[++i];
+            }
+        }
+        if (path != nullptr && !load(path, config)) { return false; }
+
+        for (int i {1}; i < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            if (arg == "--headless") {
+                config.headless = true;
+                continue;
+            }
+            for (const Option& option : options) {
+                if (arg != option.flag || i + 1 >= argc) { continue; }
+                if (!set(config, option.name, argv[++i])) {
+                    ERR("bad value for ", arg, ": ", argv[i]);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool load(const char* path, Config& config)
+    {
+        std::ifstream in {path};
+        if (!in) {
+            ERR("can not open scenario ", path, ": ",
+                std::strerror(errno));
+            return false;
+        }
+
+        std::string line;
+        for (unsigned line_no {1}; std::getline(in, line); ++line_no) {
+            std::istringstream fields {line};
+            std::string name;
+            std::string value;
+            if (!(fields >> name) || name[0] == '#') { continue; }
+            std::string extra;
+            if (!(fields >> value) || (fields >> extra) ||
+                !set(config, name, value))
+            {
+                ERR(path, ":", line_no, ": bad setting: ", line);
+                return false;
+            }
+        }
+        INFO("scenario ", path, " loaded");
+
+        return true;
+    }
+
+    Boxf default_arena()
+    {
+        // 60 degrees field of view from 40 units away, 1280x720
+        const float half_h {40.0f * std::tan(glm::radians(60.0f) / 2)};
+        const float half_w {half_h * 1280.0f / 720.0f};
+        return Boxf{-half_w, -half_h, half_w * 2, half_h * 2};
+    }
+
+    void add_players(sim::World& world, std::size_t count, Model3* ship_model)
+    {
+        const Boxf& arena {world.arena};
+        for (std::size_t i {0}; i < count && !world.ships.full(); ++i) {
+            const float t {count > 1 ?
+                static_cast<float>(i) / (count - 1) : 0.5f};
+            world.ships.push_back(Ship(
+                ship_model,
+                glm::vec3{arena.x + arena.w * (0.25f + 0.5f * t), 0.0f, 0.0f},
+                glm::vec3{0.0f},
+                glm::vec3{0.0f, 1.0f, 1.0f - 0.5f * t}));
+        }
+        world.players = world.ships.size();
+    }
+
+    void populate(
+        const Config& config,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model)
+    {
+        spawn(config, world, ship_model, rock_model);
+        INFO("scenario: ", config.ai_ships, " AI ships, ",
+             config.rocks, " rocks, fire rate ", config.fire_rate,
+             "/s, seed ", config.seed);
+    }
+
+    void spawn(
+        const Config& config,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model)
+    {
+        world.rng.reseed(config.seed);
+        Rng& rng {world.rng};
+        const Boxf& arena {world.arena};
+
+        for (unsigned i {0}; i < config.ai_ships; ++i) {
+            if (world.ships.full()) {
+                ERR("scenario: only room for ", world.ships.size(),
+                    " ships");
+                break;
+            }
+            world.ships.push_back(Ship{
+                ship_model,
+                glm::vec3{
+                    rng.uniform(arena.x, arena.x + arena.w),
+                    rng.uniform(arena.y, arena.y + arena.h),
+                    0.0f},
+                glm::vec3{0.0f, 0.0f, rng.uniform(-180.0f, 180.0f)},
+                glm::vec3{1.0f, rng.uniform(0.2f, 0.5f), 0.2f}});
+            Ship& ship {world.ships.back()};
+            if (config.fire_rate > 0.0f) {
+                ship.shot_cooldown = 1.0f / config.fire_rate;
+                ship.shot_cooldown_rem = rng.uniform(0.0f, ship.shot_cooldown);
+            } else {
+                ship.shot_cooldown_rem = std::numeric_limits<float>::infinity();
+            }
+        }
+
+        for (unsigned i {0}; i < config.rocks; ++i) {
+            if (world.rocks.full()) {
+                ERR("scenario: only room for ", world.rocks.size(),
+                    " rocks");
+                break;
+            }
+            world.rocks.push_back(Rock{
+                rock_model, glm::vec3{0.0f}, glm::vec3{0.0f}, 1.0f, 0.0f});
+            Rock& rock {world.rocks.back()};
+            sim::respawn_rock(world, rock);
+            // spread over the whole arena to start with, not just the edges
+            rock.pos = glm::vec3{
+                rng.uniform(arena.x, arena.x + arena.w),
+                rng.uniform(arena.y, arena.y + arena.h),
+                0.0f};
+        }
+
+        sim::prepare(world);
+    }
+} // namespace scenario
@@ -0,0 +1,76 @@
+#ifndef SRC_SCENARIO_HPP_
+#define SRC_SCENARIO_HPP_
+
+/*******************************************************************************
+ * Load scenarios: how many AI ships and rocks to spawn on top of the players,
+ * how fast the AI fires, the seed everything random comes from, and whether to
+ * run without a window.
+ *
+ * Settings come from a scenario file given with --scenario <file> (or
+ * RNB_SCENARIO), then from options which override the file:
+ *
+ *   --ai-ships <n>     computer controlled ships (ai_ships)
+ *   --rocks <n>        rocks (rocks)
+ *   --fire-rate <r>    shots per second of each AI ship, 0 for none (fire_rate)
+ *   --seed <n>         (seed)
+ *   --frames <n>       stop after n frames, 0 to run until closed (frames)
+ *   --headless         simulation only, no window or GL (headless 1)
+ *
+ * A file holds one "<name> <value>" pair per line, with the names in brackets
+ * above; empty lines and lines starting with '#' are skipped. The same
+ * settings always give the same run, so heavy load situations can be
+ * reproduced and profiled. See scenarios/ for examples. Ships and rocks
+ * beyond the World's capacity (sim::max_ships, sim::max_rocks) are left out.
+ ******************************************************************************/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Obj3.hpp"
+#include "sim.hpp"
+#include "utils.hpp"
+
+namespace scenario {
+    // headless runs without a frame count stop after a minute of game time
+    constexpr std::uint64_t headless_default_frames {3600};
+
+    struct Config final {
+        unsigned ai_ships {0};
+        unsigned rocks {0};
+        float fire_rate {5.0f};
+        std::uint64_t seed {1};
+        std::uint64_t frames {0};
+        bool headless {false};
+    };
+
+    // logs what's wrong and returns false on bad files or values
+    bool parse(int argc, char** argv, Config& config);
+    bool load(const char* path, Config& config);
+
+    // the arena the game shows in its default window, see main.cpp
+    Boxf default_arena();
+
+    /* adds 'count' player ships in a row across the middle of the arena and
+       makes them the world's players, for worlds without a window */
+    void add_players(sim::World& world, std::size_t count, Model3* ship_model);
+
+    /* seeds the world and adds the AI ships and rocks, the world has to have
+       its arena and players set already */
+    void populate(
+        const Config& config,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model);
+
+    // populate() without logging, for many worlds at once
+    void spawn(
+        const Config& config,
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model);
+} // namespace scenario
+
+#endif // SRC_SCENARIO_HPP_
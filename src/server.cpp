@@ -0,0 +1,519 @@
+#include "server.hpp"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "delta.hpp"
+#include "logs.hpp"
+#include "sim.hpp"
+#include "trace.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+constexpr char input_magic[4] {'R', 'N', 'B', 'I'};
+constexpr char snapshot_magic[4] {'R', 'N', 'B', 'S'};
+
+// client to server, every frame
+struct Input_packet final {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t ack; // newest snapshot the client has, or no_tick
+    std::uint32_t seq; // older ones than the last are stale
+    std::uint8_t input;
+    std::uint8_t leaving; // the last one, the slot is free again
+    std::uint8_t pad[2];
+};
+
+// server to client, followed by up to max_chunk bytes of the snapshot
+struct Chunk_header final {
+    char magic[4];
+    std::uint32_t version;
+    std::uint64_t tick; // world steps
+    std::uint64_t base; // the snapshot it's encoded against, or no_tick
+    Boxf arena; // quantization is relative to it
+    std::uint16_t chunk;
+    std::uint16_t chunks;
+    std::uint8_t player; // the receiver's ship
+    std::uint8_t pad[3];
+};
+
+constexpr std::size_t max_datagram {sizeof(Chunk_header) + server::max_chunk};
+
+bool parse_number(std::string_view str, unsigned long& out)
+{
+    if (str.empty()) { return false; }
+    const std::string s {str};
+    char* end {nullptr};
+    errno = 0;
+    out = std::strtoul(s.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+bool resolve(const std::string& host_port, sockaddr_in& out)
+{
+    const std::size_t colon {host_port.rfind(':')};
+    if (colon == std::string::npos) {
+        ERR("expected host:port, not ", host_port);
+        return false;
+    }
+    const std::string host {host_port.substr(0, colon)};
+    const std::string port {host_port.substr(colon + 1)};
+    addrinfo hints {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found {nullptr};
+    const int gai {getaddrinfo(host.c_str(), port.c_str(), &hints, &found)};
+    if (gai != 0) {
+        ERR("can not resolve ", host_port, ": ", gai_strerror(gai));
+        return false;
+    }
+    std::memcpy(&out, found->ai_addr, sizeof(out));
+    freeaddrinfo(found);
+    return true;
+}
+
+bool same_addr(const sockaddr_in& a, const sockaddr_in& b)
+{
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+std::string addr_str(const sockaddr_in& addr)
+{
+    char host[INET_ADDRSTRLEN] {};
+    inet_ntop(AF_INET, &addr.sin_addr, host, sizeof(host));
+    return std::string{host} + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
+// bytes to kB/s over 'ns'
+double kb_per_s(std::uint64_t bytes, std::uint64_t ns)
+{
+    return ns > 0 ? bytes * 1e6 / ns : 0.0;
+}
+} // namespace
+
+namespace server {
+    bool parse(int argc, char** argv, Side side, Config& config)
+    {
+        for (int i {1}; i + 1 < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            const bool server_arg {
+                arg == "--port" || arg == "--slots" || arg == "--tick-rate"};
+            if (!server_arg && arg != "--connect") { continue; }
+            if (server_arg != (side == Side::server)) {
+                ERR(arg, " is an option of the ",
+                    server_arg ? "server" : "game");
+                return false;
+            }
+
+            const std::string_view value {argv[++i]};
+            unsigned long n {0};
+            bool ok {true};
+            if (arg == "--port") {
+                ok = parse_number(value, n) && n > 0 && n <= 65535;
+                config.port = static_cast<std::uint16_t>(n);
+            } else if (arg == "--slots") {
+                ok = parse_number(value, n) && n > 0 && n <= max_slots;
+                config.slots = n;
+            } else if (arg == "--tick-rate") {
+                ok = parse_number(value, n) && n > 0 && n <= 1000;
+                config.tick_rate = static_cast<float>(n);
+            } else {
+                config.connect = value;
+                ok = value.rfind(':') != std::string_view::npos;
+            }
+            if (!ok) {
+                ERR("bad value for ", arg, ": ", value);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Socket::~Socket()
+    {
+        if (fd != -1) { close(fd); }
+    }
+
+    bool Socket::open(std::uint16_t port)
+    {
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd == -1) {
+            ERR("can not create socket: ", std::strerror(errno));
+            return false;
+        }
+        sockaddr_in addr {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            ERR("can not listen on port ", port, ": ",
+                std::strerror(errno));
+            return false;
+        }
+        return true;
+    }
+
+    void Socket::send(const sockaddr_in& to, const void* data, std::size_t size)
+    {
+        const ssize_t sent {sendto(
+            fd, data, size, 0,
+            reinterpret_cast<const sockaddr*>(&to), sizeof(to))};
+        // a full send buffer loses the datagram like the network would
+        if (sent < 0 && errno != ECONNREFUSED && errno != EAGAIN) {
+            DBG_CAT(logs::Category::net, 1, "send failed: ",
+                    std::strerror(errno));
+        }
+    }
+
+    std::size_t Socket::receive(void* data, std::size_t max, sockaddr_in& from)
+    {
+        socklen_t from_len {sizeof(from)};
+        const ssize_t got {recvfrom(
+            fd, data, max, 0, reinterpret_cast<sockaddr*>(&from), &from_len)};
+        if (got < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK &&
+                errno != ECONNREFUSED)
+            {
+                ERR("net: receive failed: ", std::strerror(errno));
+            }
+            return 0;
+        }
+        return static_cast<std::size_t>(got);
+    }
+
+    bool Server::init(const Config& config, sim::World& world, float dt)
+    {
+        if (!socket.open(config.port)) { return false; }
+
+        this->world = &world;
+        this->dt = dt;
+        slots.resize(std::min(config.slots, world.players));
+        frames.resize(history);
+        encoded.reserve(64 * 1024);
+        packet.resize(max_datagram);
+        INFO("server: listening on port ", config.port, ", ",
+             slots.size(), " slots, ", config.tick_rate, " ticks/s");
+        return true;
+    }
+
+    void Server::tick()
+    {
+        receive();
+
+        {
+            TRACE_SCOPE("update");
+            for (std::size_t i {0}; i < slots.size(); ++i) {
+                sim::apply_input(*world, i, slots[i].input, dt);
+            }
+            sim::step(*world, dt);
+        }
+
+        TRACE_SCOPE("snapshots");
+        delta::Frame& frame {frames[world->steps % history]};
+        delta::capture(*world, frame);
+        const std::uint64_t now_ns {timestamp_mono_ns()};
+        for (std::size_t i {0}; i < slots.size(); ++i) {
+            Slot& slot {slots[i]};
+            if (!slot.connected) { continue; }
+            if ((now_ns - slot.last_receive_ns) / 1e9 > client_timeout_s) {
+                INFO("server: player ", i, " at ", addr_str(slot.addr),
+                     " timed out");
+                report(i, now_ns);
+                slot = Slot{};
+                continue;
+            }
+            send_snapshot(i, frame);
+        }
+    }
+
+    std::size_t Server::clients() const
+    {
+        return static_cast<std::size_t>(std::count_if(
+            slots.begin(), slots.end(),
+            [](const Slot& slot) { return slot.connected; }));
+    }
+
+    void Server::report() const
+    {
+        const std::uint64_t now_ns {timestamp_mono_ns()};
+        INFO("server: ", clients(), " clients at the end, ",
+             turned_away, " turned away, ", packets_ignored,
+             " packets ignored");
+        for (std::size_t i {0}; i < slots.size(); ++i) {
+            if (slots[i].connected) { report(i, now_ns); }
+        }
+    }
+
+    void Server::receive()
+    {
+        TRACE_SCOPE("receive");
+        std::uint8_t data[sizeof(Input_packet)];
+        sockaddr_in from {};
+        for (std::size_t size;
+             (size = socket.receive(data, sizeof(data), from)) != 0;)
+        {
+            Input_packet in;
+            if (size != sizeof(in)) {
+                ++packets_ignored;
+                continue;
+            }
+            std::memcpy(&in, data, sizeof(in));
+            if (std::memcmp(in.magic, input_magic, sizeof(input_magic)) ||
+                in.version != protocol_version)
+            {
+                if (packets_ignored++ == 0) {
+                    ERR("server: ignoring packets from ",
+                        addr_str(from), ", another build?");
+                }
+                continue;
+            }
+
+            auto slot {std::find_if(
+                slots.begin(), slots.end(), [&from](const Slot& s) {
+                    return s.connected && same_addr(s.addr, from);
+                })};
+            const std::uint64_t now_ns {timestamp_mono_ns()};
+            if (slot == slots.end()) {
+                if (in.leaving) { continue; }
+                slot = std::find_if(
+                    slots.begin(), slots.end(),
+                    [](const Slot& s) { return !s.connected; });
+                if (slot == slots.end()) {
+                    if (turned_away++ == 0) {
+                        ERR("server: full, turning away ",
+                            addr_str(from));
+                    }
+                    continue;
+                }
+                *slot = Slot{};
+                slot->connected = true;
+                slot->addr = from;
+                slot->joined_ns = now_ns;
+                INFO("server: ", addr_str(from), " joined as player ",
+                     slot - slots.begin());
+            } else if (in.seq <= slot->input_seq) {
+                // overtaken by a newer one, its ack is older too
+                slot->bytes_in += size;
+                continue;
+            }
+            if (in.leaving) {
+                const std::size_t i {
+                    static_cast<std::size_t>(slot - slots.begin())};
+                INFO("server: player ", i, " at ", addr_str(from),
+                     " left");
+                report(i, now_ns);
+                *slot = Slot{};
+                continue;
+            }
+
+            slot->input = in.input;
+            slot->input_seq = in.seq;
+            if (in.ack != no_tick &&
+                (slot->acked == no_tick || in.ack > slot->acked))
+            {
+                slot->acked = in.ack;
+            }
+            slot->last_receive_ns = now_ns;
+            slot->bytes_in += size;
+        }
+    }
+
+    void Server::send_snapshot(std::size_t i, const delta::Frame& frame)
+    {
+        Slot& slot {slots[i]};
+        static const delta::Frame none {};
+        const delta::Frame* baseline {&none};
+        if (slot.acked != no_tick && slot.acked < frame.steps &&
+            frames[slot.acked % history].steps == slot.acked)
+        {
+            baseline = &frames[slot.acked % history];
+        } else {
+            ++slot.full_snapshots;
+        }
+
+        encoded.clear();
+        const std::size_t size {delta::encode(frame, *baseline, encoded)};
+        const std::size_t chunks {(size + max_chunk - 1) / max_chunk};
+        Chunk_header head {};
+        std::memcpy(head.magic, snapshot_magic, sizeof(snapshot_magic));
+        head.version = protocol_version;
+        head.tick = frame.steps;
+        head.base = baseline == &none ? no_tick : baseline->steps;
+        head.arena = world->arena;
+        head.chunks = static_cast<std::uint16_t>(chunks);
+        head.player = static_cast<std::uint8_t>(i);
+        for (std::size_t c {0}; c < chunks; ++c) {
+            const std::size_t offset {c * max_chunk};
+            const std::size_t part {std::min(max_chunk, size - offset)};
+            head.chunk = static_cast<std::uint16_t>(c);
+            std::memcpy(packet.data(), &head, sizeof(head));
+            std::memcpy(packet.data() + sizeof(head),
+                        encoded.data() + offset, part);
+            socket.send(slot.addr, packet.data(), sizeof(head) + part);
+            slot.bytes_out += sizeof(head) + part;
+        }
+        ++slot.snapshots;
+    }
+
+    void Server::report(std::size_t i, std::uint64_t now_ns) const
+    {
+        const Slot& slot {slots[i]};
+        const std::uint64_t ns {now_ns - slot.joined_ns};
+        INFO("server: player ", i, " ", slot.snapshots,
+             " snapshots (", slot.full_snapshots, " full), ",
+             slot.snapshots > 0 ? slot.bytes_out / slot.snapshots : 0,
+             " bytes each, ", kb_per_s(slot.bytes_out, ns),
+             " kB/s out, ", kb_per_s(slot.bytes_in, ns), " kB/s in");
+    }
+
+    bool Client::init(const Config& config)
+    {
+        if (!resolve(config.connect, server_addr) || !socket.open(0)) {
+            return false;
+        }
+        open = true;
+        frames.resize(history);
+        assembled.reserve(64 * 1024);
+        start_ns = timestamp_mono_ns();
+        last_receive_ns = start_ns;
+        INFO("client: sending to ", config.connect);
+        return true;
+    }
+
+    void Client::send_input(std::uint8_t input)
+    {
+        Input_packet out {};
+        std::memcpy(out.magic, input_magic, sizeof(input_magic));
+        out.version = protocol_version;
+        out.ack = newest;
+        out.seq = ++input_seq;
+        out.input = input;
+        socket.send(server_addr, &out, sizeof(out));
+        bytes_out += sizeof(out);
+    }
+
+    void Client::leave()
+    {
+        Input_packet out {};
+        std::memcpy(out.magic, input_magic, sizeof(input_magic));
+        out.version = protocol_version;
+        out.ack = newest;
+        out.seq = ++input_seq;
+        out.leaving = 1;
+        // it may get lost, the server times the slot out then
+        for (int i {0}; i < 3; ++i) {
+            socket.send(server_addr, &out, sizeof(out));
+            bytes_out += sizeof(out);
+        }
+    }
+
+    bool Client::update(
+        sim::World& world,
+        Model3* ship_model,
+        Model3* rock_model)
+    {
+        TRACE_SCOPE("snapshots");
+        std::uint8_t data[max_datagram];
+        sockaddr_in from {};
+        bool got {false};
+        for (std::size_t size;
+             (size = socket.receive(data, sizeof(data), from)) != 0;)
+        {
+            if (!same_addr(from, server_addr)) { continue; }
+            bytes_in += size;
+            last_receive_ns = timestamp_mono_ns();
+            got = take_chunk(data, size) || got;
+        }
+        if (!got) { return false; }
+
+        world.arena = arena;
+        delta::apply(frames[newest % history], world, ship_model, rock_model);
+        return true;
+    }
+
+    double Client::idle_s() const
+    {
+        return (timestamp_mono_ns() - last_receive_ns) / 1e9;
+    }
+
+    void Client::report() const
+    {
+        const std::uint64_t ns {timestamp_mono_ns() - start_ns};
+        INFO("client: player ", slot, ", ", decoded, " snapshots, ",
+             decoded > 0 ? bytes_in / decoded : 0, " bytes each, ",
+             incomplete, " incomplete, ", undecodable,
+             " without baseline, ", kb_per_s(bytes_in, ns),
+             " kB/s in, ", kb_per_s(bytes_out, ns), " kB/s out");
+    }
+
+    bool Client::take_chunk(const std::uint8_t* data, std::size_t size)
+    {
+        Chunk_header head;
+        if (size < sizeof(head)) { return false; }
+        std::memcpy(&head, data, sizeof(head));
+        const std::size_t part {size - sizeof(head)};
+        if (std::memcmp(head.magic, snapshot_magic, sizeof(snapshot_magic)) ||
+            head.version != protocol_version || head.chunk >= head.chunks ||
+            part > max_chunk || (head.chunk + 1 < head.chunks &&
+                                 part != max_chunk))
+        {
+            return false;
+        }
+        // late chunks of older snapshots are of no use any more
+        if ((newest != no_tick && head.tick <= newest) ||
+            (tick != no_tick && head.tick < tick))
+        {
+            return false;
+        }
+
+        if (head.tick != tick) {
+            if (tick != no_tick && chunks_left > 0) { ++incomplete; }
+            tick = head.tick;
+            base = head.base;
+            arena = head.arena;
+            slot = head.player;
+            chunks_got.assign(head.chunks, false);
+            chunks_left = head.chunks;
+            assembled.resize(head.chunks * max_chunk);
+            assembled_size = 0;
+        }
+        if (head.chunks != chunks_got.size() || chunks_got[head.chunk]) {
+            return false;
+        }
+        chunks_got[head.chunk] = true;
+        std::memcpy(assembled.data() + head.chunk * max_chunk,
+                    data + sizeof(head), part);
+        assembled_size += part;
+        if (--chunks_left > 0) { return false; }
+
+        static const delta::Frame none {};
+        const delta::Frame& baseline {
+            base == no_tick ? none : frames[base % history]};
+        if ((base != no_tick && baseline.steps != base) ||
+            !delta::decode(assembled.data(), assembled_size, baseline, frame))
+        {
+            ++undecodable;
+            return false;
+        }
+        std::swap(frames[tick % history], frame);
+        newest = tick;
+        ++decoded;
+        return true;
+    }
+} // namespace server
@@ -0,0 +1,191 @@
+#ifndef SRC_SERVER_HPP_
+#define SRC_SERVER_HPP_
+
+/*******************************************************************************
+ * Dedicated server: one process owns the simulation, clients only send their
+ * input and draw the state they get back.
+ *
+ * The server (server_main.cpp, "make server", no GL or GLFW) ticks the World
+ * at a fixed rate. Every client sending input gets one of the player ships,
+ * its latest input is applied each tick until a newer one arrives. After each
+ * tick every client gets a snapshot delta encoded (see delta.hpp) against the
+ * newest one it acknowledged, split into datagrams of at most max_chunk bytes.
+ * A snapshot missing a chunk is dropped, the next one goes against an older
+ * baseline and makes up for it. Clients give up their ship when they quit,
+ * or when the server hasn't heard from them for client_timeout_s.
+ *
+ *   --port <port>       UDP port the server listens on (default 47200)
+ *   --slots <n>         player ships, the most clients at once (default 8)
+ *   --tick-rate <hz>    ticks per second (default 60)
+ *
+ * The scenario options (scenario.hpp) set up the rest of the world, --frames
+ * stops after that many ticks. The game joins a server with
+ *
+ *   --connect <host:port>
+ *
+ * and then only draws, with --headless it sends scripted input instead and
+ * stops after --frames snapshots. dev/server_loopback.sh runs a server and a
+ * few of those over localhost. Both sides have to run the same build, packets
+ * of another protocol version are ignored. Byte order is the machine's.
+ ******************************************************************************/
+
+#include <netinet/in.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "delta.hpp"
+#include "sim.hpp"
+
+namespace server {
+    // bumped whenever the packets or the delta encoding change
+    constexpr std::uint32_t protocol_version {1};
+    constexpr std::uint16_t default_port {47200};
+    constexpr std::size_t max_slots {32};
+    // snapshot bytes per datagram, below the usual MTU
+    constexpr std::size_t max_chunk {1200};
+    // snapshots kept on both sides to encode against, by tick
+    constexpr std::size_t history {64};
+    constexpr double client_timeout_s {5.0};
+    constexpr std::uint64_t no_tick {std::numeric_limits<std::uint64_t>::max()};
+
+    struct Config final {
+        std::uint16_t port {default_port};
+        std::size_t slots {8};
+        float tick_rate {60.0f};
+        std::string connect; // host:port of a server, for the game
+    };
+
+    enum class Side { server, client };
+
+    /* reads the options of one side, false if one is malformed or belongs to
+       the other side */
+    bool parse(int argc, char** argv, Side side, Config& config);
+
+    // a nonblocking UDP socket, sending to anyone
+    class Socket final {
+    public:
+        Socket() = default;
+        ~Socket();
+
+        Socket(const Socket&) = delete;
+        Socket& operator=(const Socket&) = delete;
+
+        // port 0 for any
+        bool open(std::uint16_t port);
+
+        void send(const sockaddr_in& to, const void* data, std::size_t size);
+
+        /* the next datagram into 'data' (up to 'max' bytes) and who sent
+           it, 0 when there is none */
+        std::size_t receive(void* data, std::size_t max, sockaddr_in& from);
+
+    private:
+        int fd {-1};
+    };
+
+    class Server final {
+    public:
+        /* starts listening, the world's first config.slots ships are the
+           clients'; false if the socket can't be set up */
+        bool init(const Config& config, sim::World& world, float dt);
+
+        // takes in input, steps the world and sends the snapshots
+        void tick();
+
+        std::size_t clients() const;
+
+        // bandwidth of every client so far
+        void report() const;
+
+    private:
+        struct Slot final {
+            bool connected {false};
+            sockaddr_in addr {};
+            std::uint8_t input {0};
+            std::uint32_t input_seq {0};
+            std::uint64_t acked {no_tick}; // newest snapshot it has
+            std::uint64_t joined_ns {0};
+            std::uint64_t last_receive_ns {0};
+            std::uint64_t bytes_in {0};
+            std::uint64_t bytes_out {0};
+            std::uint64_t snapshots {0};
+            std::uint64_t full_snapshots {0}; // without a baseline
+        };
+
+        void receive();
+        void send_snapshot(std::size_t slot, const delta::Frame& frame);
+        void report(std::size_t slot, std::uint64_t now_ns) const;
+
+        Socket socket;
+        sim::World* world {nullptr};
+        float dt {0.0f};
+        std::vector<Slot> slots; // by player ship
+        std::vector<delta::Frame> frames; // the last 'history' ticks
+        std::vector<std::uint8_t> encoded;
+        std::vector<std::uint8_t> packet;
+        std::uint64_t packets_ignored {0};
+        std::uint64_t turned_away {0};
+    };
+
+    // the game's side of it
+    class Client final {
+    public:
+        // false if the server can't be resolved or the socket set up
+        bool init(const Config& config);
+
+        bool active() const { return open; }
+
+        // our player ship, once a snapshot arrived
+        std::uint32_t player() const { return slot; }
+
+        // a datagram per call, acknowledging the newest snapshot
+        void send_input(std::uint8_t input);
+
+        // frees our ship for someone else, no more input after it
+        void leave();
+
+        /* takes in what arrived; if that completed a snapshot newer than the
+           last, puts it in 'world' with the given models and returns true */
+        bool update(sim::World& world, Model3* ship_model, Model3* rock_model);
+
+        std::uint64_t snapshots() const { return decoded; }
+
+        // seconds since the last datagram from the server
+        double idle_s() const;
+
+        void report() const;
+
+    private:
+        bool take_chunk(const std::uint8_t* data, std::size_t size);
+
+        Socket socket;
+        sockaddr_in server_addr {};
+        bool open {false};
+        std::uint32_t slot {0};
+        std::uint32_t input_seq {0};
+        std::uint64_t newest {no_tick}; // newest snapshot decoded
+        // the snapshot being put together from its chunks
+        std::uint64_t tick {no_tick};
+        std::uint64_t base {no_tick};
+        Boxf arena {};
+        std::size_t assembled_size {0};
+        std::vector<bool> chunks_got;
+        std::size_t chunks_left {0};
+        std::vector<std::uint8_t> assembled;
+        std::vector<delta::Frame> frames; // the last 'history' decoded
+        delta::Frame frame;
+        std::uint64_t last_receive_ns {0};
+        std::uint64_t start_ns {0};
+        std::uint64_t bytes_in {0};
+        std::uint64_t bytes_out {0};
+        std::uint64_t decoded {0};
+        std::uint64_t incomplete {0}; // replaced before all chunks arrived
+        std::uint64_t undecodable {0}; // baseline gone
+    };
+} // namespace server
+
+#endif // SRC_SERVER_HPP_
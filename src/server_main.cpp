@@ -0,0 +1,114 @@
+/* The dedicated server, see server.hpp. Built from the same simulation code as
+ * the game but without anything of GL or GLFW, "make server". Runs until
+ * interrupted or --frames ticks, then reports tick times and the bandwidth of
+ * every client. */
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "Frame_stats.hpp"
+#include "alloc_tracker.hpp"
+#include "flight_recorder.hpp"
+#include "logs.hpp"
+#include "scenario.hpp"
+#include "server.hpp"
+#include "sim.hpp"
+#include "trace.hpp"
+#include "version.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+volatile std::sig_atomic_t stop {0};
+
+void on_signal(int) { stop = 1; }
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const std::string program_name {"Rocks and Bullets server"};
+
+    logs::init(argc, argv);
+    flight::init(argc, argv);
+    trace::init(argc, argv);
+    trace::set_thread_name("main");
+    alloc_tracker::init(argc, argv);
+    scenario::Config scenario;
+    if (!scenario::parse(argc, argv, scenario)) { return -1; }
+    server::Config config;
+    if (!server::parse(argc, argv, server::Side::server, config)) { return -1; }
+    INFO("PROGRAM START");
+    INFO("name: ", program_name, " ", version_str());
+
+    // too big for the stack
+    const auto world_mem {std::make_unique<sim::World>()};
+    sim::World& world {*world_mem};
+    // clients get the arena with every snapshot
+    world.arena = scenario::default_arena();
+    // whether anyone flies them or not
+    scenario::add_players(world, config.slots, nullptr);
+    scenario::populate(scenario, world, nullptr, nullptr);
+
+    const float dt {1.0f / config.tick_rate};
+    server::Server server;
+    if (!server.init(config, world, dt)) { return -1; }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    Frame_stats tick_stats {dt * 1000.0};
+    tick_stats.init(argc, argv, "server_tick");
+    const auto tick_ns {static_cast<std::uint64_t>(dt * 1e9)};
+    std::uint64_t next_tick_ns {timestamp_mono_ns()};
+    std::uint64_t prev_tick_start_ns {0};
+    std::uint64_t ticks {0};
+    for (; !stop && (scenario.frames == 0 || ticks < scenario.frames);
+         ++ticks)
+    {
+        const std::uint64_t tick_start_ns {timestamp_mono_ns()};
+        {
+            TRACE_SCOPE("tick");
+            server.tick();
+        }
+        const std::uint64_t work_ns {timestamp_mono_ns() - tick_start_ns};
+        flight::add_frame(flight::Frame_sample{
+            ticks,
+            tick_start_ns,
+            static_cast<std::uint32_t>(work_ns),
+            static_cast<std::uint16_t>(world.ships.size()),
+            static_cast<std::uint16_t>(world.rocks.size()),
+            static_cast<std::uint32_t>(world.bullets.size())});
+        if (prev_tick_start_ns != 0) {
+            tick_stats.add(Frame_stats::Sample{
+                (tick_start_ns - prev_tick_start_ns) / 1e6,
+                work_ns / 1e6,
+                Frame_stats::no_gpu});
+        }
+        prev_tick_start_ns = tick_start_ns;
+        alloc_tracker::end_frame();
+
+        // fixed rate, a late tick makes the next ones come sooner
+        next_tick_ns += tick_ns;
+        const std::uint64_t now_ns {timestamp_mono_ns()};
+        if (next_tick_ns > now_ns) {
+            TRACE_SCOPE("sleep");
+            std::this_thread::sleep_for(
+                std::chrono::nanoseconds{next_tick_ns - now_ns});
+        }
+    }
+
+    INFO("server: ", ticks, " ticks, ", world.bullets.size(),
+         " bullets in flight, ", world.rock_hits, " rocks hit");
+    tick_stats.report();
+    server.report();
+    trace::write();
+    alloc_tracker::report();
+    INFO("PROGRAM END");
+    return 0;
+}
@@ -0,0 +1,271 @@
+#include "sim.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Collision_grid.hpp"
+#include "trace.hpp"
+
+namespace {
+constexpr float min_rock_radius {0.8f};
+constexpr float max_rock_speed {0.08f}; // per step
+constexpr float max_ai_speed {0.25f}; // per step, AI only thrusts below it
+
+// degrees in [-180, 180)
+float wrap_angle(float deg)
+{
+    deg = std::fmod(deg + 180.0f, 360.0f);
+    return (deg < 0.0f ? deg + 360.0f : deg) - 180.0f;
+}
+
+void steer_ai(sim::World& world, float dt)
+{
+    TRACE_SCOPE("ai");
+    for (std::size_t i {world.players}; i < world.ships.size(); ++i) {
+        Ship& ship {world.ships[i]};
+        sim::Ai_state& ai {world.ai[i - world.players]};
+
+        ai.retarget_in -= dt;
+        if (!world.rocks.empty() &&
+            (ai.retarget_in <= 0.0f || ai.target >= world.rocks.size()))
+        {
+            ai.target = world.rng.below(
+                static_cast<std::uint32_t>(world.rocks.size()));
+            ai.retarget_in = world.rng.uniform(1.0f, 3.0f);
+        }
+
+        // turn towards the target rock, or just circle without one
+        float turn {ship.rot_rate * dt * 0.5f};
+        if (!world.rocks.empty()) {
+            const glm::vec3 to {world.rocks[ai.target].pos - ship.pos};
+            const float facing {glm::degrees(std::atan2(-to.x, to.y))};
+            turn = std::clamp(wrap_angle(facing - ship.rot.z),
+                              -ship.rot_rate * dt, ship.rot_rate * dt);
+        }
+        ship.rot.z = wrap_angle(ship.rot.z + turn);
+
+        if (glm::dot(ship.vel, ship.vel) < max_ai_speed * max_ai_speed &&
+            world.rng.chance(0.1f))
+        {
+            ship.vel += ship.accel * ship.front * dt;
+        }
+
+        // fires whenever the gun is ready, the scenario sets the rate
+        sim::fire(ship, world.bullets, world.muzzle_vel);
+    }
+}
+
+void update_rocks(sim::World& world, float dt)
+{
+    for (Rock& rock : world.rocks) {
+        rock.pos += rock.vel;
+        sim::wrap(rock.pos, world.arena);
+        rock.rot.z = wrap_angle(rock.rot.z + rock.spin * dt);
+    }
+}
+
+/* derived from the rocks every step, so not part of the World; per thread so
+   worlds can step in parallel */
+thread_local Collision_grid rock_grid;
+thread_local std::vector<std::uint8_t> rock_hit;
+
+void collide_bullets(sim::World& world)
+{
+    TRACE_SCOPE("collide");
+    rock_grid.reset(world.arena, sim::max_rock_radius);
+    rock_grid.build(world.rocks.size(), [&world](std::size_t i) {
+        return world.rocks[i].pos;
+    });
+    rock_hit.assign(world.rocks.size(), 0);
+
+    for (std::size_t b {0}; b < world.bullets.size();) {
+        const glm::vec3 pos {world.bullets[b].pos};
+        bool hit {false};
+        rock_grid.query(pos.x, pos.y, [&](std::uint32_t r) {
+            const Rock& rock {world.rocks[r]};
+            const float dx {pos.x - rock.pos.x};
+            const float dy {pos.y - rock.pos.y};
+            if (!hit && rock_hit[r] == 0 &&
+                dx * dx + dy * dy < rock.radius * rock.radius)
+            {
+                rock_hit[r] = 1;
+                hit = true;
+            }
+        });
+        if (hit) {
+            world.bullets[b] = world.bullets.back();
+            world.bullets.pop_back();
+        } else {
+            ++b;
+        }
+    }
+
+    // after the loop, so the grid stays valid for all bullets
+    for (std::size_t r {0}; r < world.rocks.size(); ++r) {
+        if (rock_hit[r] != 0) {
+            sim::respawn_rock(world, world.rocks[r]);
+            ++world.rock_hits;
+        }
+    }
+}
+} // namespace
+
+namespace sim {
+    void wrap(glm::vec3& pos, const Boxf& arena)
+    {
+        if (pos.x < arena.x) {
+            pos.x += arena.w;
+        } else if (pos.x > arena.x + arena.w) {
+            pos.x -= arena.w;
+        }
+        if (pos.y < arena.y) {
+            pos.y += arena.h;
+        } else if (pos.y > arena.y + arena.h) {
+            pos.y -= arena.h;
+        }
+    }
+
+    void update_bullets(Bullets& bullets, const Boxf& arena)
+    {
+        for (std::size_t i {0}; i < bullets.size();) {
+            Bullet& bullet {bullets[i]};
+            bullet.pos += bullet.vel;
+            if (bullet.pos.x < arena.x ||
+                bullet.pos.x > arena.x + arena.w ||
+                bullet.pos.y < arena.y ||
+                bullet.pos.y > arena.y + arena.h)
+            {
+                bullet = bullets.back();
+                bullets.pop_back();
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void update_ships(
+        Ship* ships,
+        std::size_t count,
+        const Boxf& arena,
+        float dt)
+    {
+        for (std::size_t i {0}; i < count; ++i) {
+            Ship& ship {ships[i]};
+            ship.pos += ship.vel;
+            wrap(ship.pos, arena);
+
+            ship.front.x = -std::sin(glm::radians(ship.rot.z));
+            ship.front.y = std::cos(glm::radians(ship.rot.z));
+
+            if (ship.shot_cooldown_rem > 0.0f) {ship.shot_cooldown_rem -= dt;}
+        }
+    }
+
+    bool fire(Ship& ship, Bullets& bullets, float muzzle_vel)
+    {
+        if (ship.shot_cooldown_rem > 0.0f) { return false; }
+
+        // spawn with ship-relative pos so ship-relative rot works well
+        if (!bullets.push_back(Bullet{ship.gun_disp, ship.vel})) {
+            return false;
+        }
+        Bullet& bullet {bullets.back()};
+
+        glm::mat4 trans_mx {1.0f};
+        /* TODO prob. better use Obj3.rot as axis argument containing
+           fraction of 360deg instead of passing rot and hardcoded
+           axis, feels more natural data-wise and more efficient if we
+           later need rotation for more than one axis simultaneously. */
+        trans_mx = glm::rotate(
+            trans_mx,
+            glm::radians(ship.rot.z),
+            glm::vec3(0.0f, 0.0f, 1.0f));
+        // just because we need vec4 for glm rotation calc, I'm lazy atm
+        glm::vec4 pos_buf {bullet.pos, 0.0f};
+        pos_buf = trans_mx * pos_buf;
+        bullet.pos.x = pos_buf.x;
+        bullet.pos.y = pos_buf.y;
+
+        // move to world-relative pos,no longer care about ship-relative
+        bullet.pos += ship.pos;
+
+        // bullet be propelled towards where the ship (gun) is facing
+        bullet.vel.x += muzzle_vel * ship.front.x;
+        bullet.vel.y += muzzle_vel * ship.front.y;
+
+        ship.shot_cooldown_rem += ship.shot_cooldown;
+
+        return true;
+    }
+
+    void prepare(World& world)
+    {
+        world.ai.resize(world.ships.size() - world.players, Ai_state{0, 0.0f});
+    }
+
+    void reserve_scratch(const Boxf& arena)
+    {
+        rock_grid.reset(arena, max_rock_radius);
+        rock_grid.reserve(max_rocks);
+        rock_hit.reserve(max_rocks);
+    }
+
+    void respawn_rock(World& world, Rock& rock)
+    {
+        const Boxf& arena {world.arena};
+        Rng& rng {world.rng};
+        rock.radius = rng.uniform(min_rock_radius, max_rock_radius);
+        const float along {rng.unit()};
+        switch (rng.below(4)) {
+            case 0:
+                rock.pos = glm::vec3{arena.x + along * arena.w, arena.y, 0.0f};
+                break;
+            case 1:
+                rock.pos = glm::vec3{
+                    arena.x + along * arena.w, arena.y + arena.h, 0.0f};
+                break;
+            case 2:
+                rock.pos = glm::vec3{arena.x, arena.y + along * arena.h, 0.0f};
+                break;
+            default:
+                rock.pos = glm::vec3{
+                    arena.x + arena.w, arena.y + along * arena.h, 0.0f};
+                break;
+        }
+        rock.vel = glm::vec3{
+            rng.uniform(-max_rock_speed, max_rock_speed),
+            rng.uniform(-max_rock_speed, max_rock_speed),
+            0.0f};
+        rock.rot.z = rng.uniform(-180.0f, 180.0f);
+        rock.spin = rng.uniform(-90.0f, 90.0f);
+    }
+
+    void apply_input(
+        World& world,
+        std::size_t player,
+        std::uint8_t input,
+        float dt)
+    {
+        Ship& ship {world.ships[player]};
+        if (input & IB_thrust) { ship.vel += ship.accel * ship.front * dt; }
+        if (input & IB_left) { ship.rot.z += ship.rot_rate * dt; }
+        if (input & IB_right) { ship.rot.z -= ship.rot_rate * dt; }
+        if (input & IB_fire) { fire(ship, world.bullets, world.muzzle_vel); }
+    }
+
+    void step(World& world, float dt)
+    {
+        steer_ai(world, dt);
+        update_bullets(world.bullets, world.arena);
+        update_ships(world.ships.data(), world.ships.size(), world.arena, dt);
+        update_rocks(world, dt);
+        collide_bullets(world);
+        ++world.steps;
+    }
+} // namespace sim
@@ -0,0 +1,121 @@
+#ifndef SRC_SIM_HPP_
+#define SRC_SIM_HPP_
+
+/* Game simulation, moving things around the arena. Kept apart from input and
+ * rendering so it can also run without a window (headless mode, dev/bench).
+ *
+ * Given the same World and the same player input a step always ends in the
+ * same state, all randomness comes from the World's own Rng. The World is
+ * all of that state in one block of plain data, save() and restore() copy it
+ * with a single memcpy (see Snapshot_ring.hpp for keeping recent ones). */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Fixed_vector.hpp"
+#include "Obj3.hpp"
+#include "Rng.hpp"
+#include "Rock.hpp"
+#include "Ship.hpp"
+#include "utils.hpp"
+
+namespace sim {
+    // a player's controls during one step, or-ed together
+    enum Input_bit : std::uint8_t {
+        IB_thrust = 1 << 0,
+        IB_left = 1 << 1,
+        IB_right = 1 << 2,
+        IB_fire = 1 << 3
+    };
+
+    // what a computer controlled ship is up to
+    struct Ai_state final {
+        std::uint32_t target; // rock index
+        float retarget_in; // seconds
+    };
+
+    /* capacities of the World, ships include the players; a full bullet
+       pool means no ship fires until some have left */
+    constexpr std::size_t max_ships {256};
+    constexpr std::size_t max_rocks {1024};
+    constexpr std::size_t max_bullets {8192};
+
+    using Bullets = Fixed_vector<Bullet, max_bullets>;
+
+    /* about 320 KiB, too much for the stack of most threads. Ships and rocks
+       point to their models, those have to outlive every copy */
+    struct World final {
+        Boxf arena {0.0f, 0.0f, 0.0f, 0.0f};
+        float muzzle_vel {0.05f};
+        Fixed_vector<Ship, max_ships> ships; // player controlled ones first
+        std::size_t players {0};
+        Fixed_vector<Ai_state, max_ships> ai; // for ships[players] onward
+        Fixed_vector<Rock, max_rocks> rocks;
+        Bullets bullets;
+        Rng rng;
+        std::uint64_t steps {0};
+        std::uint64_t rock_hits {0};
+    };
+
+    static_assert(std::is_trivially_copyable_v<World>,
+                  "World has to stay plain data for save() and restore()");
+
+    inline void save(const World& world, World& snapshot)
+    {
+        std::memcpy(&snapshot, &world, sizeof(World));
+    }
+
+    inline void restore(World& world, const World& snapshot)
+    {
+        std::memcpy(&world, &snapshot, sizeof(World));
+    }
+
+    // largest rock radius, also the broadphase cell size
+    constexpr float max_rock_radius {2.5f};
+
+    // sets up the AI state for the ships, call after adding ships
+    void prepare(World& world);
+
+    /* grows the calling thread's scratch of step() to a full World in
+       'arena', stepping on the thread allocates nothing after that */
+    void reserve_scratch(const Boxf& arena);
+
+    // puts a rock of random size and heading just inside a random edge
+    void respawn_rock(World& world, Rock& rock);
+
+    // steers player 'player' by 'input' (Input_bit), before step()
+    void apply_input(
+        World& world,
+        std::size_t player,
+        std::uint8_t input,
+        float dt);
+
+    /* one fixed time step: AI ships steer and fire, everything moves, bullets
+       hitting rocks are dropped and the rocks respawn; player input is
+       applied to the ships before calling it */
+    void step(World& world, float dt);
+
+    // brings 'pos' back in on the opposite side if it left the arena
+    void wrap(glm::vec3& pos, const Boxf& arena);
+
+    // moves bullets, drops those that left the arena (order is not kept)
+    void update_bullets(Bullets& bullets, const Boxf& arena);
+
+    // moves ships wrapping around the arena, updates facing and cooldowns
+    void update_ships(
+        Ship* ships,
+        std::size_t count,
+        const Boxf& arena,
+        float dt);
+
+    /* fires a bullet from the ship's gun unless it's cooling down or there is
+       no room for another bullet */
+    bool fire(Ship& ship, Bullets& bullets, float muzzle_vel);
+} // namespace sim
+
+#endif // SRC_SIM_HPP_
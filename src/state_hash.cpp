@@ -0,0 +1,259 @@
+#include "state_hash.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include "hash.hpp"
+#include "logs.hpp"
+#include "sim.hpp"
+
+namespace {
+template<std::size_t N>
+std::uint32_t entity_hash(const float (&fields)[N])
+{
+    return static_cast<std::uint32_t>(hash::xxh64(fields, sizeof(fields)));
+}
+
+template<typename T>
+bool write_value(std::FILE* file, const T& v)
+{
+    return std::fwrite(&v, sizeof(v), 1, file) == 1;
+}
+
+template<typename T>
+bool read_value(std::FILE* file, T& v)
+{
+    return std::fread(&v, sizeof(v), 1, file) == 1;
+}
+
+bool write_step(std::FILE* file, const state_hash::Step& step)
+{
+    return write_value(file, step.step) && write_value(file, step.world) &&
+        write_value(file, step.ships) && write_value(file, step.bullets) &&
+        write_value(file, step.rocks) &&
+        std::fwrite(step.entities.data(), sizeof(step.entities[0]),
+                    step.entities.size(), file) == step.entities.size();
+}
+
+std::FILE* open_file(const char* path, const char* mode)
+{
+    std::FILE* file {std::fopen(path, mode)};
+    if (file == nullptr) {
+        ERR("can not open state hashes ", path, ": ",
+            std::strerror(errno));
+    }
+    return file;
+}
+
+enum class Kind {ship, bullet, rock};
+
+constexpr const char* kind_names[] {"ship", "bullet", "rock"};
+
+// which kind of entity the hash at 'i' belongs to and its index in that kind
+Kind entity_of(const state_hash::Step& step, std::size_t& i)
+{
+    if (i < step.ships) { return Kind::ship; }
+    i -= step.ships;
+    if (i < step.bullets) { return Kind::bullet; }
+    i -= step.bullets;
+    return Kind::rock;
+}
+} // namespace
+
+namespace state_hash {
+    void compute(const sim::World& world, Step& out)
+    {
+        out.step = world.steps;
+        out.ships = static_cast<std::uint32_t>(world.ships.size());
+        out.bullets = static_cast<std::uint32_t>(world.bullets.size());
+        out.rocks = static_cast<std::uint32_t>(world.rocks.size());
+        out.entities.clear();
+
+        for (const Ship& ship : world.ships) {
+            const float fields[] {
+                ship.pos.x, ship.pos.y, ship.pos.z,
+                ship.vel.x, ship.vel.y, ship.vel.z,
+                ship.rot.x, ship.rot.y, ship.rot.z,
+                ship.front.x, ship.front.y, ship.front.z,
+                ship.shot_cooldown_rem};
+            out.entities.push_back(entity_hash(fields));
+        }
+        for (const Bullet& bullet : world.bullets) {
+            const float fields[] {
+                bullet.pos.x, bullet.pos.y, bullet.pos.z,
+                bullet.vel.x, bullet.vel.y, bullet.vel.z};
+            out.entities.push_back(entity_hash(fields));
+        }
+        for (const Rock& rock : world.rocks) {
+            const float fields[] {
+                rock.pos.x, rock.pos.y, rock.pos.z,
+                rock.vel.x, rock.vel.y, rock.vel.z,
+                rock.rot.z, rock.radius, rock.spin};
+            out.entities.push_back(entity_hash(fields));
+        }
+
+        // the rest of the state seeds the hash over the entities
+        const std::uint64_t other[] {
+            world.steps, world.rng.raw_state(), world.rock_hits,
+            world.players};
+        std::uint64_t h {hash::xxh64(other, sizeof(other))};
+        h = hash::xxh64(
+            world.ai.data(), world.ai.size() * sizeof(world.ai[0]), h);
+        out.world = hash::xxh64(
+            out.entities.data(),
+            out.entities.size() * sizeof(out.entities[0]),
+            h);
+    }
+
+    Checker::~Checker()
+    {
+        if (log_file != nullptr) { std::fclose(log_file); }
+        if (check_file != nullptr) { std::fclose(check_file); }
+    }
+
+    bool Checker::init(int argc, char** argv)
+    {
+        const char* log_path {std::getenv("RNB_HASH_LOG")};
+        const char* check_path {nullptr};
+        for (int i {1}; i < argc; ++i) {
+            const std::string_view arg {argv[i]};
+            if (arg == "--hash-log" && i + 1 < argc) {
+                log_path = argv[++i];
+            } else if (arg == "--hash-check" && i + 1 < argc) {
+                check_path = argv[++i];
+            }
+        }
+
+        if (log_path != nullptr) {
+            log_file = open_file(log_path, "wb");
+            if (log_file == nullptr ||
+                std::fwrite(magic, sizeof(magic), 1, log_file) != 1)
+            {
+                return false;
+            }
+            INFO("writing state hashes to ", log_path);
+        }
+        if (check_path != nullptr) {
+            check_file = open_file(check_path, "rb");
+            if (check_file == nullptr) { return false; }
+            char file_magic[sizeof(magic)];
+            if (!read_value(check_file, file_magic) ||
+                std::memcmp(file_magic, magic, sizeof(magic)) != 0)
+            {
+                ERR(check_path, " is not a state hash file");
+                return false;
+            }
+            INFO("checking state hashes against ", check_path);
+        }
+
+        return true;
+    }
+
+    void Checker::after_step(const sim::World& world)
+    {
+        const bool dbg {logs::dbg_enabled(logs::Category::sim, 2)};
+        if (log_file == nullptr && check_file == nullptr && !dbg) { return; }
+
+        compute(world, current);
+        DBG_CAT(logs::Category::sim, 2, "step ", current.step, " hash ",
+                current.world);
+
+        if (log_file != nullptr && !write_step(log_file, current)) {
+            ERR("can not write state hashes, stopped");
+            std::fclose(log_file);
+            log_file = nullptr;
+        }
+
+        if (check_file == nullptr) { return; }
+        if (!read_expected()) {
+            INFO("state hashes checked up to step ", current.step - 1,
+                 ", no more to compare with");
+        } else if (expected.world != current.world ||
+                   expected.step != current.step)
+        {
+            divergence_step = current.step;
+            report(world);
+        } else {
+            return;
+        }
+        // nothing more to learn after the end or the first divergence
+        std::fclose(check_file);
+        check_file = nullptr;
+    }
+
+    bool Checker::read_expected()
+    {
+        if (!read_value(check_file, expected.step) ||
+            !read_value(check_file, expected.world) ||
+            !read_value(check_file, expected.ships) ||
+            !read_value(check_file, expected.bullets) ||
+            !read_value(check_file, expected.rocks))
+        {
+            return false;
+        }
+        expected.entities.resize(static_cast<std::size_t>(expected.ships) +
+                                 expected.bullets + expected.rocks);
+        return std::fread(expected.entities.data(),
+                          sizeof(expected.entities[0]),
+                          expected.entities.size(), check_file) ==
+            expected.entities.size();
+    }
+
+    void Checker::report(const sim::World& world) const
+    {
+        ERR("state diverged at step ", current.step, " (expected step ",
+            expected.step, "), world hash ", current.world,
+            " instead of ", expected.world);
+        if (expected.ships != current.ships ||
+            expected.bullets != current.bullets ||
+            expected.rocks != current.rocks)
+        {
+            ERR("  entity counts ships/bullets/rocks ", current.ships,
+                "/", current.bullets, "/", current.rocks, " instead of ",
+                expected.ships, "/", expected.bullets, "/",
+                expected.rocks);
+        }
+
+        std::size_t i {0};
+        while (i < current.entities.size() && i < expected.entities.size() &&
+               current.entities[i] == expected.entities[i])
+        {
+            ++i;
+        }
+        if (i == current.entities.size() && i == expected.entities.size()) {
+            ERR("  all entities match, the rest of the state differs");
+            return;
+        }
+
+        if (i == current.entities.size()) {
+            const Kind kind {entity_of(expected, i)};
+            ERR("  first difference: ",
+                kind_names[static_cast<int>(kind)], " ", i,
+                " is missing in this run");
+            return;
+        }
+
+        const Kind kind {entity_of(current, i)};
+        const Obj3* obj {nullptr};
+        switch (kind) {
+            case Kind::ship: obj = &world.ships[i]; break;
+            case Kind::rock: obj = &world.rocks[i]; break;
+            case Kind::bullet: {
+                const Bullet& bullet {world.bullets[i]};
+                ERR("  first difference: bullet ", i, " now at ",
+                    bullet.pos.x, ", ", bullet.pos.y, " moving ",
+                    bullet.vel.x, ", ", bullet.vel.y);
+            } return;
+        }
+        ERR("  first difference: ",
+            kind_names[static_cast<int>(kind)], " ", i,
+            " now at ", obj->pos.x, ", ", obj->pos.y, " moving ",
+            obj->vel.x, ", ", obj->vel.y);
+    }
+} // namespace state_hash
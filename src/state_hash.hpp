@@ -0,0 +1,78 @@
+#ifndef SRC_STATE_HASH_HPP_
+#define SRC_STATE_HASH_HPP_
+
+/*******************************************************************************
+ * Simulation state hashes, to prove a change doesn't change gameplay.
+ *
+ * After every step each ship, bullet and rock gets a 32 bit hash of its state
+ * (the float bits, so -0 and 0 differ) and the world a 64 bit one over those
+ * and everything else (Rng state, counters). Hashes are logged with
+ * "--log sim=2".
+ *
+ * "--hash-log <file>" (or RNB_HASH_LOG) writes them to a file, about 4 bytes
+ * per entity per step. "--hash-check <file>" compares every step with such a
+ * file and reports the first step that diverged and the first entity that
+ * differs in it, a headless run then exits with an error. To check an
+ * optimisation, record a replay and its hashes with the old build, then
+ * replay it with --hash-check in the new one.
+ ******************************************************************************/
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "sim.hpp"
+
+namespace state_hash {
+    constexpr char magic[8] {'R', 'N', 'B', 'H', 'S', 'H', '0', '1'};
+
+    /* in the file after the magic, one after the other: the fields in this
+       order, then 'ships', 'bullets' and 'rocks' entity hashes in that
+       order */
+    struct Step final {
+        std::uint64_t step; // sim::World::steps
+        std::uint64_t world;
+        std::uint32_t ships;
+        std::uint32_t bullets;
+        std::uint32_t rocks;
+        std::vector<std::uint32_t> entities;
+    };
+
+    // reuses out.entities' memory
+    void compute(const sim::World& world, Step& out);
+
+    class Checker final {
+    public:
+        Checker() = default;
+        ~Checker();
+
+        Checker(const Checker&) = delete;
+        Checker& operator=(const Checker&) = delete;
+
+        // false if a file can't be opened
+        bool init(int argc, char** argv);
+
+        // hashes the world if anything wants the hashes, call after a step
+        void after_step(const sim::World& world);
+
+        // writing or checking hashes
+        bool active() const
+        {
+            return log_file != nullptr || check_file != nullptr;
+        }
+
+        bool diverged() const { return divergence_step != 0; }
+
+    private:
+        bool read_expected();
+        void report(const sim::World& world) const;
+
+        std::FILE* log_file {nullptr};
+        std::FILE* check_file {nullptr};
+        Step current {};
+        Step expected {};
+        std::uint64_t divergence_step {0};
+    };
+} // namespace state_hash
+
+#endif // SRC_STATE_HASH_HPP_
@@ -0,0 +1,50 @@
+#include "text.hpp"
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "font_atlas.hpp"
+
+std::size_t layout_text(
+    std::string_view str,
+    float x,
+    float y,
+    float height,
+    std::vector<float>& verts)
+{
+    constexpr float cell_u {1.0f / font_atlas::columns};
+    constexpr float cell_v {1.0f / font_atlas::rows};
+    const float width {height * font_atlas::glyph_w / font_atlas::glyph_h};
+
+    const std::size_t start {verts.size()};
+    float pen_x {x};
+    for (char c : str) {
+        if (c == '\n') {
+            pen_x = x;
+            y -= height;
+            continue;
+        }
+
+        // atlas rows go top to bottom, v = 0 is the top of the image
+        const font_atlas::Cell cell {font_atlas::cell(c)};
+        const float u0 {cell.col * cell_u};
+        const float u1 {u0 + cell_u};
+        const float v_top {cell.row * cell_v};
+        const float v_bot {v_top + cell_v};
+        const float x1 {pen_x + width};
+        const float y1 {y + height};
+
+        verts.insert(verts.end(), {
+            pen_x, y,  0.0f, u0, v_bot, // bottom left
+            x1,    y,  0.0f, u1, v_bot, // bottom right
+            pen_x, y1, 0.0f, u0, v_top, // top left
+            pen_x, y1, 0.0f, u0, v_top, // top left
+            x1,    y,  0.0f, u1, v_bot, // bottom right
+            x1,    y1, 0.0f, u1, v_top, // top right
+        });
+        pen_x = x1;
+    }
+
+    return (verts.size() - start) / 5;
+}
@@ -0,0 +1,23 @@
+#ifndef SRC_TEXT_HPP_
+#define SRC_TEXT_HPP_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/* appends the vertices of 'str' to 'verts', two triangles per char, 5 floats
+ * per vertex (3x position, 2x texture coord into a gfx/fonts atlas)
+ *
+ * 'x' and 'y' are the bottom left of the first char and 'height' is the line
+ * height, all in model space. The width of a char follows the atlas' glyph
+ * aspect ratio. '\n' starts a new line below.
+ *
+ * returns the number of vertices appended */
+std::size_t layout_text(
+    std::string_view str,
+    float x,
+    float y,
+    float height,
+    std::vector<float>& verts);
+
+#endif // SRC_TEXT_HPP_
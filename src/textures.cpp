@@ -0,0 +1,87 @@
+#include "textures.hpp"
+
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <ktx.h>
+
+#include "logs.hpp"
+#include "trace.hpp"
+
+GLuint load_ktx_texture(const char* path)
+{
+    TRACE_SCOPE("load texture");
+
+    static bool ktx_gl_loaded {false};
+    if (!ktx_gl_loaded) {
+        KTX_error_code result {
+            ktxLoadOpenGL((PFNGLGETPROCADDRESS)glfwGetProcAddress)};
+        if (result != KTX_SUCCESS) {
+            ERR("KTX LoadOpenGL failed: ", ktxErrorString(result));
+            return 0;
+        }
+        ktx_gl_loaded = true;
+    }
+
+    ktxTexture2* k_texture;
+    KTX_error_code result {ktxTexture2_CreateFromNamedFile(
+        path, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &k_texture)};
+    if (result != KTX_SUCCESS) {
+        ERR(
+            "KTX create from ", path, " failed: ", ktxErrorString(result));
+        return 0;
+    }
+
+    const ktx_uint32_t components {ktxTexture2_GetNumComponents(k_texture)};
+    DBG_CAT(logs::Category::assets, 1,
+            "loading texture ", path, " ", k_texture->baseWidth, "x",
+            k_texture->baseHeight, " components: ", components);
+
+    /* TODO - adapt transcode target format based on GPU extensions available,
+       at least differentiate between BC3-7, as desktops are priority now */
+    /* force transcoding to BC as it may want to default to ASTC but that's
+       usually only available on mobile cards. */
+    if (ktxTexture2_NeedsTranscoding(k_texture)) {
+        ktx_transcode_fmt_e fmt {KTX_TTF_BC7_RGBA};
+        if (components == 1) {
+            fmt = KTX_TTF_BC4_R;
+        } else if (components == 2) {
+            fmt = KTX_TTF_BC5_RG;
+        }
+        result = ktxTexture2_TranscodeBasis(k_texture, fmt, 0);
+        if (result != KTX_SUCCESS) {
+            ERR(
+                "KTX ktxTexture2_TranscodeBasis failed:",
+                ktxErrorString(result));
+            ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(k_texture));
+            return 0;
+        }
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    /* all upcoming GL_TEXTURE_2D operations now have effect on this texture
+       object */
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    GLenum target, glerror;
+    result = ktxTexture_GLUpload(
+        reinterpret_cast<ktxTexture*>(k_texture), &texture, &target, &glerror);
+    ktxTexture_Destroy(reinterpret_cast<ktxTexture*>(k_texture));
+    if (result != KTX_SUCCESS) {
+        ERR("KTX GLUpload failed: ", ktxErrorString(result));
+        glDeleteTextures(1, &texture);
+        return 0;
+    }
+
+    // alpha masks come in as red only, make them sample as white with alpha
+    if (components == 1) {
+        const GLint swizzle[] {GL_ONE, GL_ONE, GL_ONE, GL_RED};
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+
+    return texture;
+}
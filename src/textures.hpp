@@ -0,0 +1,17 @@
+#ifndef SRC_TEXTURES_HPP_
+#define SRC_TEXTURES_HPP_
+
+#include <GL/glew.h>
+
+/* loads a 2D KTX2 texture and uploads it to the GPU, Basis compressed data is
+ * transcoded to a BC format matching the number of channels
+ *
+ * One-channel textures (R8, or BC4 if transcoded) are alpha masks, such as
+ * font atlases. They are swizzled to sample as (1, 1, 1, R), so shaders can
+ * treat them the same as a white RGBA texture while only a quarter of the
+ * memory of an RGBA8 upload is used.
+ *
+ * returns the texture name, 0 on error */
+GLuint load_ktx_texture(const char* path);
+
+#endif // SRC_TEXTURES_HPP_
@@ -1,21 +1,57 @@
+#define _POSIX_C_SOURCE 200809L // localtime_r, clock_gettime
+
 #include "timestamp.h"
 
+#include <string.h>
 #include <time.h>
-#include <stdio.h>
 
-#define TIMESTAMP_NANO_BUF_SIZE 32
-static char timestamp_nano_buf[TIMESTAMP_NANO_BUF_SIZE];
+static _Thread_local char timestamp_nano_buf[TIMESTAMP_NANO_SIZE];
+
+/* localtime_r + strftime are by far the most expensive part, only redo them
+   when the second changes */
+static _Thread_local time_t cached_sec = -1;
+static _Thread_local char cached_hms[9]; // "HH:MM:SS" without terminator
+
+char* timestamp_nano_fmt(const struct timespec* ts, char* buf)
+{
+    if (ts->tv_sec != cached_sec) {
+        struct tm tm;
+        char tmp[16];
+        localtime_r(&ts->tv_sec, &tm);
+        strftime(tmp, sizeof(tmp), "%T", &tm);
+        memcpy(cached_hms, tmp, 8);
+        cached_sec = ts->tv_sec;
+    }
+
+    memcpy(buf, cached_hms, 8);
+    buf[8] = '.';
+    long nsec = ts->tv_nsec;
+    for (int i = 17; i >= 9; --i) {
+        buf[i] = (char)('0' + nsec % 10);
+        nsec /= 10;
+    }
+    buf[18] = '\0';
+
+    return buf;
+}
 
 char* timestamp_nano()
 {
     struct timespec ts;
     timespec_get(&ts, TIME_UTC);
-    size_t rc =
-        strftime(&timestamp_nano_buf[0], TIMESTAMP_NANO_BUF_SIZE,
-                 "%T", localtime(&ts.tv_sec));
-    snprintf(&timestamp_nano_buf[rc], TIMESTAMP_NANO_BUF_SIZE, ".%09ld",
-             ts.tv_nsec);
 
-    return &timestamp_nano_buf[0];
+    return timestamp_nano_fmt(&ts, timestamp_nano_buf);
 }
 
+char* timestamp_nano_at(const struct timespec* ts)
+{
+    return timestamp_nano_fmt(ts, timestamp_nano_buf);
+}
+
+uint64_t timestamp_mono_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
@@ -1,6 +1,25 @@
 #ifndef SRC_TIMESTAMP_H_
 #define SRC_TIMESTAMP_H_
 
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/* "HH:MM:SS.nnnnnnnnn" plus terminator, local time */
+#define TIMESTAMP_NANO_SIZE 19
+
+/* Formats 'ts' into 'buf' (at least TIMESTAMP_NANO_SIZE long), returns buf.
+ * The HH:MM:SS part is cached per second and per thread, so only the
+ * sub-second digits are formatted on most calls. Thread-safe. */
+char* timestamp_nano_fmt(const struct timespec* ts, char* buf);
+
+/* Current time / given time formatted into a thread-local buffer, valid until
+ * the same thread calls either again. */
 char* timestamp_nano();
+char* timestamp_nano_at(const struct timespec* ts);
+
+/* Raw monotonic clock in nanoseconds, for ordering and measuring rather than
+ * for reading. */
+uint64_t timestamp_mono_ns();
 
 #endif // SRC_TIMESTAMP_H_
@@ -0,0 +1,190 @@
+#include "trace.hpp"
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logs.hpp"
+
+extern "C" {
+#include "timestamp.h"
+}
+
+namespace {
+constexpr std::uint32_t chunk_events {4096};
+
+struct Event {
+    const char* name;
+    std::uint64_t start_ns;
+    std::uint64_t end_ns;
+};
+
+/* only the owning thread appends, write() reads up to 'count' and follows
+   'next' concurrently */
+struct Chunk {
+    Event events[chunk_events];
+    std::atomic<std::uint32_t> count {0};
+    std::atomic<Chunk*> next {nullptr};
+};
+
+struct Thread_buffer {
+    explicit Thread_buffer(std::uint32_t tid): tid {tid}, tail {&head} {}
+    ~Thread_buffer()
+    {
+        Chunk* c {head.next.load()};
+        while (c != nullptr) {
+            Chunk* next {c->next.load()};
+            delete c;
+            c = next;
+        }
+    }
+
+    const std::uint32_t tid;
+    std::atomic<const char*> name {nullptr};
+    Chunk head;
+    Chunk* tail; // owner only
+};
+
+std::mutex buffers_mutex;
+std::vector<std::unique_ptr<Thread_buffer>> buffers;
+std::string trace_path;
+
+// set_thread_name()'s, kept for the buffer if tracing was off back then
+thread_local const char* thread_name {nullptr};
+
+Thread_buffer& own_buffer()
+{
+    thread_local Thread_buffer* buf {nullptr};
+    if (buf == nullptr) {
+        static std::atomic<std::uint32_t> next_tid {1};
+        auto new_buf {std::make_unique<Thread_buffer>(next_tid++)};
+        new_buf->name.store(thread_name, std::memory_order_relaxed);
+        buf = new_buf.get();
+        std::lock_guard<std::mutex> lock {buffers_mutex};
+        buffers.push_back(std::move(new_buf));
+    }
+    return *buf;
+}
+
+void write_json_str(std::ostream& out, std::string_view str)
+{
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\') { out << '\\'; }
+        out << c;
+    }
+    out << '"';
+}
+
+// trace event times are in microseconds
+void write_us(std::ostream& out, std::uint64_t ns)
+{
+    out << ns / 1000 << '.' << std::setw(3) << std::setfill('0') << ns % 1000;
+}
+} // namespace
+
+namespace trace {
+    std::atomic<bool> enabled {false};
+
+    void init(int argc, char** argv)
+    {
+        const char* path {std::getenv("RNB_TRACE")};
+        for (int i {1}; i < argc; ++i) {
+            if (std::string_view{argv[i]} == "--trace" && i + 1 < argc) {
+                path = argv[++i];
+            }
+        }
+        if (path == nullptr) { return; }
+
+        trace_path = path;
+        enabled.store(true);
+        INFO("tracing into ", trace_path);
+    }
+
+    void set_thread_name(const char* name)
+    {
+        thread_name = name;
+        // a buffer only once there's something to record
+        if (!enabled.load(std::memory_order_relaxed)) { return; }
+        own_buffer().name.store(name, std::memory_order_relaxed);
+    }
+
+    void add(const char* name, std::uint64_t start_ns, std::uint64_t end_ns)
+    {
+        Thread_buffer& buf {own_buffer()};
+        std::uint32_t n {buf.tail->count.load(std::memory_order_relaxed)};
+        if (n == chunk_events) {
+            Chunk* chunk {new Chunk};
+            buf.tail->next.store(chunk, std::memory_order_release);
+            buf.tail = chunk;
+            n = 0;
+        }
+        buf.tail->events[n] = Event{name, start_ns, end_ns};
+        buf.tail->count.store(n + 1, std::memory_order_release);
+    }
+
+    void write()
+    {
+        if (!enabled.load()) { return; }
+
+        std::ofstream out {trace_path};
+        if (!out) {
+            ERR("can not write trace ", trace_path);
+            return;
+        }
+
+        const pid_t pid {getpid()};
+        bool first {true};
+        out << "{\"traceEvents\":[";
+
+        std::lock_guard<std::mutex> lock {buffers_mutex};
+        for (const auto& buf : buffers) {
+            if (const char* name {buf->name.load()}; name != nullptr) {
+                out << (first ? "\n" : ",\n")
+                    << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid
+                    << ",\"tid\":" << buf->tid << ",\"args\":{\"name\":";
+                write_json_str(out, name);
+                out << "}}";
+                first = false;
+            }
+
+            for (const Chunk* c {&buf->head}; c != nullptr;
+                 c = c->next.load(std::memory_order_acquire))
+            {
+                const std::uint32_t n {
+                    c->count.load(std::memory_order_acquire)};
+                for (std::uint32_t i {0}; i < n; ++i) {
+                    const Event& ev {c->events[i]};
+                    out << (first ? "\n" : ",\n") << "{\"ph\":\"X\",\"name\":";
+                    write_json_str(out, ev.name);
+                    out << ",\"pid\":" << pid << ",\"tid\":" << buf->tid
+                        << ",\"ts\":";
+                    write_us(out, ev.start_ns);
+                    out << ",\"dur\":";
+                    write_us(out, ev.end_ns - ev.start_ns);
+                    out << "}";
+                    first = false;
+                }
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        if (!out) {
+            ERR("failed writing trace ", trace_path);
+        } else {
+            INFO("trace written to ", trace_path);
+        }
+    }
+
+    std::uint64_t now_ns() { return timestamp_mono_ns(); }
+} // namespace trace
@@ -0,0 +1,87 @@
+#ifndef SRC_TRACE_HPP_
+#define SRC_TRACE_HPP_
+
+/*******************************************************************************
+ * Timeline tracing.
+ *
+ * With --trace <file> (or RNB_TRACE) scopes marked with TRACE_SCOPE or a
+ * trace::Scope are recorded as they happen on any thread and written to the
+ * file by trace::write() as Chrome trace event JSON, open it in
+ * chrome://tracing or ui.perfetto.dev.
+ *
+ * Each thread records into its own buffer, nothing is shared or locked on the
+ * way in. When tracing is off a scope costs two relaxed atomic loads. Names
+ * must be string literals (or otherwise live until the trace is written),
+ * only the pointer is stored.
+ *
+ * Scopes are also the zones alloc_tracker attributes allocations to, whether
+ * tracing is on or not.
+ ******************************************************************************/
+
+#include <atomic>
+#include <cstdint>
+
+#include "alloc_tracker.hpp"
+
+namespace trace {
+    extern std::atomic<bool> enabled;
+
+    // "--trace <file>" or RNB_TRACE=<file> turns tracing on
+    void init(int argc, char** argv);
+
+    // shown instead of the thread id, call from the thread itself
+    void set_thread_name(const char* name);
+
+    // records a finished scope on the calling thread
+    void add(const char* name, std::uint64_t start_ns, std::uint64_t end_ns);
+
+    /* writes everything recorded so far, other threads may keep recording
+       while it does, their newer events are left out */
+    void write();
+
+    std::uint64_t now_ns();
+
+    // records its lifetime, or until end() if that comes first
+    class Scope final {
+    public:
+        explicit Scope(const char* name)
+        : name {name},
+          start_ns {enabled.load(std::memory_order_relaxed) ? now_ns() : 0},
+          count_allocs {
+              alloc_tracker::enabled.load(std::memory_order_relaxed)},
+          allocs_start {
+              count_allocs ? alloc_tracker::thread_counts() :
+              alloc_tracker::Counts{}}
+        {}
+        ~Scope() { end(); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void end()
+        {
+            if (start_ns != 0) {
+                add(name, start_ns, now_ns());
+                start_ns = 0;
+            }
+            if (count_allocs) {
+                alloc_tracker::zone_done(name, allocs_start);
+                count_allocs = false;
+            }
+        }
+
+    private:
+        const char* name;
+        std::uint64_t start_ns;
+        bool count_allocs;
+        alloc_tracker::Counts allocs_start;
+    };
+} // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// traces the rest of the enclosing block
+#define TRACE_SCOPE(name) \
+    trace::Scope TRACE_CONCAT(trace_scope_, __LINE__) {(name)}
+
+#endif // SRC_TRACE_HPP_
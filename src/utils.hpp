@@ -9,7 +9,7 @@
  * things that are only one or two of a kind.
  ******************************************************************************/
 
-#include <GL/glew.h>
+#include <string>
 
 
 struct Boxf final {
@@ -31,10 +31,7 @@ struct Size2 {
     int h;
 };
 
-// loads vert and frag shader from file path
-// returns 0 on error
-GLuint load_shaders(
-    const char* vertex_file_path,
-    const char* fragment_file_path);
+// reads the whole file into 'out', returns false if it can't be opened
+bool read_text_file(const char* path, std::string& out);
 
 #endif // SRC_UTILS_HPP_